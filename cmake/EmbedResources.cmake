@@ -1,7 +1,54 @@
+# How embedfile writes each resource: INCBIN (assembler .incbin, GCC/Clang), EMBED (C23 #embed)
+# or HEX (a byte array literal, any compiler). AUTO picks the first one the C compiler supports.
+set(EMBED_RESOURCES_MODE "AUTO" CACHE STRING "How resources are embedded: AUTO, INCBIN, EMBED or HEX")
+set_property(CACHE EMBED_RESOURCES_MODE PROPERTY STRINGS AUTO INCBIN EMBED HEX)
+# Packs every resource into one aligned blob (g_resource_pack) instead of one symbol and one
+# translation unit per file; same as passing PACKED to embed_resources.
+option(EMBED_RESOURCES_PACKED "Embed all resources as one packed blob" OFF)
+
+function(_embed_resources_mode OUT_VAR)
+    set(MODE "${EMBED_RESOURCES_MODE}")
+    if(MODE STREQUAL "AUTO")
+        if(CMAKE_C_COMPILER_ID MATCHES "GNU|Clang" AND NOT CMAKE_C_COMPILER_FRONTEND_VARIANT STREQUAL "MSVC")
+            set(MODE "INCBIN")
+        else()
+            include(CheckCSourceCompiles)
+            set(PROBE "${CMAKE_BINARY_DIR}/embed_probe.bin")
+            file(WRITE "${PROBE}" "x")
+            check_c_source_compiles("static const char probe[] = {\n#embed \"${PROBE}\"\n};\nint main(void) { return probe[0] != 'x'; }\n" EMBED_RESOURCES_HAS_EMBED)
+            if(EMBED_RESOURCES_HAS_EMBED)
+                set(MODE "EMBED")
+            else()
+                set(MODE "HEX")
+            endif()
+        endif()
+    endif()
+    if(NOT MODE MATCHES "^(INCBIN|EMBED|HEX)$")
+        message(FATAL_ERROR "Unknown EMBED_RESOURCES_MODE: ${MODE}")
+    endif()
+    message(STATUS "Embedding resources with ${MODE}")
+    string(TOLOWER "${MODE}" MODE)
+    set(${OUT_VAR} "${MODE}" PARENT_SCOPE)
+endfunction()
+
 function(embed_resources RESOURCE_DIR OUT_VAR)
-    cmake_parse_arguments(ARG "" "" "EXCLUDE_EXTENSIONS" ${ARGN})
+    cmake_parse_arguments(ARG "PACKED;BAKE_MIPMAPS" "ALIGNMENT" "EXCLUDE_EXTENSIONS;COMPRESS_EXTENSIONS;BAKE_IMAGES;BAKE_SOUNDS" ${ARGN})
 
     file(GLOB_RECURSE RESOURCE_FILES CONFIGURE_DEPENDS RELATIVE "${RESOURCE_DIR}" "${RESOURCE_DIR}/*")
+    _embed_resources_mode(EMBED_MODE)
+    if(EMBED_RESOURCES_PACKED)
+        set(ARG_PACKED TRUE)
+    endif()
+    if(NOT ARG_ALIGNMENT)
+        set(ARG_ALIGNMENT 16)
+    endif()
+
+    # Packed: files are appended to the pack in path order (so a directory's files are
+    # adjacent), and each res_* name becomes a macro for its place in g_resource_pack.
+    set(PACK_SYMBOL "g_resource_pack")
+    set(PACK_FILES)
+    set(PACK_LINES)
+    set(PACK_COUNT 0)
 
     set(GENERATED_C_FILES)
     set(RESOURCE_DECLS)
@@ -13,6 +60,8 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
     set(NODE_ISDIRS)
     set(NODE_DATASYMS)
     set(NODE_LENS)
+    set(NODE_SIZES)
+    set(NODE_FORMATS)
     set(NODE_PARENTS)
 
     macro(_resource_node_key PATH OUT_KEY)
@@ -45,6 +94,8 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
         list(APPEND NODE_ISDIRS "${IS_DIR}")
         list(APPEND NODE_DATASYMS "${DATA_VALUE}")
         list(APPEND NODE_LENS "${LEN_VALUE}")
+        list(APPEND NODE_SIZES "${LEN_VALUE}")
+        list(APPEND NODE_FORMATS "RESOURCE_FORMAT_FILE")
         list(APPEND NODE_PARENTS "${PARENT}")
         set(${OUT_INDEX} ${INDEX})
     endmacro()
@@ -88,6 +139,42 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
             continue()
         endif()
 
+        # Baked images and sounds are decoded at build time by resbake (src/util/resbake.cpp), and
+        # the baked file is embedded in place of the original under the original's path.
+        set(BAKE_KIND)
+        if(FILE_EXT IN_LIST ARG_BAKE_IMAGES)
+            set(BAKE_KIND image)
+            set(BAKE_FORMAT RESOURCE_FORMAT_IMAGE)
+        elseif(FILE_EXT IN_LIST ARG_BAKE_SOUNDS)
+            set(BAKE_KIND wave)
+            set(BAKE_FORMAT RESOURCE_FORMAT_WAVE)
+        endif()
+        set(EMBED_SOURCE "${RESOURCE_DIR}/${RESOURCE_FILE}")
+        if(BAKE_KIND)
+            set(EMBED_SOURCE "${CMAKE_CURRENT_BINARY_DIR}/baked/${RESOURCE_FILE}.${BAKE_KIND}")
+            set(BAKE_FLAGS)
+            if(BAKE_KIND STREQUAL "image" AND ARG_BAKE_MIPMAPS)
+                set(BAKE_FLAGS --mipmaps)
+            endif()
+            add_custom_command(
+                OUTPUT "${EMBED_SOURCE}"
+                COMMAND resbake ${BAKE_KIND} ${BAKE_FLAGS} "${RESOURCE_DIR}/${RESOURCE_FILE}" "${EMBED_SOURCE}"
+                DEPENDS "${RESOURCE_DIR}/${RESOURCE_FILE}"
+                COMMENT "Baking ${RESOURCE_FILE}"
+                VERBATIM
+            )
+        endif()
+
+        # Compressed extensions are stored lz_fast compressed when that makes them smaller and
+        # have to be read through ResourceCache (src/util/resource_cache.h).
+        set(COMPRESS_FILE FALSE)
+        foreach(COMPRESSED_EXT ${ARG_COMPRESS_EXTENSIONS})
+            if(FILE_EXT STREQUAL "${COMPRESSED_EXT}")
+                set(COMPRESS_FILE TRUE)
+                break()
+            endif()
+        endforeach()
+
         # Create symbol name: res_ui_icons_play_png
         string(REPLACE "/" "_" SYMBOL_PATH "${RESOURCE_FILE}")
         string(REPLACE "." "_" SYMBOL_NAME "${SYMBOL_PATH}")
@@ -117,13 +204,40 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
         # Add the file node itself
         _resource_add_node("${RESOURCE_FILE}" "${FILE_NAME}" 0 "${SYMBOL_NAME}" "${SYMBOL_NAME}_len" "${PARENT_INDEX}" FILE_INDEX)
 
-        # Output .c file
+        if(ARG_PACKED OR COMPRESS_FILE)
+            _resource_list_set(NODE_SIZES ${FILE_INDEX} "${SYMBOL_NAME}_size")
+        endif()
+        if(BAKE_KIND)
+            _resource_list_set(NODE_FORMATS ${FILE_INDEX} "${BAKE_FORMAT}")
+        endif()
+
+        if(ARG_PACKED)
+            list(APPEND PACK_FILES "${EMBED_SOURCE}")
+            if(COMPRESS_FILE)
+                list(APPEND PACK_LINES "z ${EMBED_SOURCE}")
+            else()
+                list(APPEND PACK_LINES "- ${EMBED_SOURCE}")
+            endif()
+            string(APPEND RESOURCE_DECLS "#define ${SYMBOL_NAME} (${PACK_SYMBOL} + ${PACK_SYMBOL}_offset_${PACK_COUNT})\n")
+            string(APPEND RESOURCE_DECLS "#define ${SYMBOL_NAME}_len (${PACK_SYMBOL}_lens[${PACK_COUNT}])\n")
+            string(APPEND RESOURCE_DECLS "#define ${SYMBOL_NAME}_size (${PACK_SYMBOL}_sizes[${PACK_COUNT}])\n\n")
+            math(EXPR PACK_COUNT "${PACK_COUNT} + 1")
+            continue()
+        endif()
+
+        # Output .c file. With INCBIN/EMBED it only names the resource, and embedfile rewrites it
+        # whenever the resource changes so the object is rebuilt.
         set(OUTPUT_C "${CMAKE_CURRENT_BINARY_DIR}/${SYMBOL_NAME}.c")
 
+        set(COMPRESS_FLAG)
+        if(COMPRESS_FILE)
+            set(COMPRESS_FLAG -z)
+        endif()
+
         add_custom_command(
             OUTPUT "${OUTPUT_C}"
-            COMMAND embedfile "${SYMBOL_NAME}" "${RESOURCE_DIR}/${RESOURCE_FILE}"
-            DEPENDS "${RESOURCE_DIR}/${RESOURCE_FILE}"
+            COMMAND embedfile -m ${EMBED_MODE} -o "${CMAKE_CURRENT_BINARY_DIR}" ${COMPRESS_FLAG} "${SYMBOL_NAME}" "${EMBED_SOURCE}"
+            DEPENDS "${EMBED_SOURCE}"
             COMMENT "Embedding ${RESOURCE_FILE} as ${SYMBOL_NAME}"
             VERBATIM
         )
@@ -133,9 +247,35 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
 
         # Add to extern declarations
         string(APPEND RESOURCE_DECLS "extern const unsigned char ${SYMBOL_NAME}[];\n")
-        string(APPEND RESOURCE_DECLS "extern const unsigned long long ${SYMBOL_NAME}_len;\n\n")
+        string(APPEND RESOURCE_DECLS "extern const unsigned long long ${SYMBOL_NAME}_len;\n")
+        if(COMPRESS_FILE)
+            string(APPEND RESOURCE_DECLS "extern const unsigned long long ${SYMBOL_NAME}_size;\n")
+        endif()
+        string(APPEND RESOURCE_DECLS "\n")
     endforeach()
 
+    if(ARG_PACKED)
+        set(PACK_C "${CMAKE_CURRENT_BINARY_DIR}/${PACK_SYMBOL}.c")
+        set(PACK_H "${CMAKE_CURRENT_BINARY_DIR}/${PACK_SYMBOL}.h")
+        set(PACK_LIST "${CMAKE_CURRENT_BINARY_DIR}/${PACK_SYMBOL}.list")
+
+        # Only touch the list when it changes, so reconfiguring does not repack.
+        string(REPLACE ";" "\n" PACK_LIST_CONTENT "${PACK_LINES}")
+        file(WRITE "${PACK_LIST}.tmp" "${PACK_LIST_CONTENT}\n")
+        configure_file("${PACK_LIST}.tmp" "${PACK_LIST}" COPYONLY)
+
+        add_custom_command(
+            OUTPUT "${PACK_C}" "${PACK_H}"
+            BYPRODUCTS "${CMAKE_CURRENT_BINARY_DIR}/${PACK_SYMBOL}.pack"
+            COMMAND embedfile -m ${EMBED_MODE} -a ${ARG_ALIGNMENT} -o "${CMAKE_CURRENT_BINARY_DIR}" -l "${PACK_LIST}" ${PACK_SYMBOL}
+            DEPENDS ${PACK_FILES} "${PACK_LIST}"
+            COMMENT "Packing ${PACK_COUNT} resources into ${PACK_SYMBOL}"
+            VERBATIM
+        )
+        list(APPEND GENERATED_C_FILES "${PACK_C}" "${PACK_H}")
+        set(RESOURCE_DECLS "#include \"${PACK_SYMBOL}.h\"\n\n${RESOURCE_DECLS}")
+    endif()
+
     # Write the resources.c file containing extern declarations
     set(RESOURCES_C "${CMAKE_CURRENT_BINARY_DIR}/resources.c")
     set(RESOURCES_C_CONTENT "// Auto-generated resource declarations\n\n${RESOURCE_DECLS}")
@@ -187,30 +327,69 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
         endif()
     endforeach()
 
+    # Node indices sorted by path for findResource(). A tab sorts below every path character,
+    # so sorting "path<TAB>index" orders by path exactly like strcmp.
+    set(SORTED_ENTRIES)
+    foreach(i RANGE 0 ${LAST_INDEX})
+        if(NOT i EQUAL ROOT_INDEX)
+            list(GET NODE_PATHS ${i} NODE_PATH)
+            list(APPEND SORTED_ENTRIES "${NODE_PATH}\t${i}")
+        endif()
+    endforeach()
+    list(SORT SORTED_ENTRIES)
+    set(SORTED_INDICES)
+    foreach(ENTRY ${SORTED_ENTRIES})
+        string(REGEX REPLACE "^.*\t" "" INDEX "${ENTRY}")
+        string(APPEND SORTED_INDICES "${INDEX}, ")
+    endforeach()
+    list(LENGTH SORTED_ENTRIES SORTED_COUNT)
+    if(SORTED_COUNT EQUAL 0)
+        set(SORTED_INDICES "-1")
+    endif()
+
     # Emit tree header and source
     set(RESOURCE_TREE_H "${CMAKE_CURRENT_BINARY_DIR}/resource_tree.h")
     set(RESOURCE_TREE_C "${CMAKE_CURRENT_BINARY_DIR}/resource_tree.c")
 
     set(RESOURCE_TREE_H_CONTENT "// Auto-generated resource tree\n\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "#ifndef RESOURCE_TREE_H\n#define RESOURCE_TREE_H\n\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "#include <stddef.h>\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "#ifdef __cplusplus\n#include <string_view>\n#endif\n\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "#ifdef __cplusplus\nextern \"C\" {\n#endif\n\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "// What a file's data holds: the file as is, or what resbake made of it (util/baked_resource.h).\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "#define RESOURCE_FORMAT_FILE 0\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "#define RESOURCE_FORMAT_IMAGE 1\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "#define RESOURCE_FORMAT_WAVE 2\n\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "typedef struct ResourceNode {\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  const char* name;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  const char* path;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  const unsigned char* data;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  const unsigned long long* len;\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "  const unsigned long long* size; // uncompressed; data is lz_fast compressed if *len < *size\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  int parent;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  int first_child;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  int next_sibling;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "  int is_dir;\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "  int format;\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "} ResourceNode;\n\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "extern const ResourceNode g_resource_nodes[];\n")
     string(APPEND RESOURCE_TREE_H_CONTENT "extern const unsigned int g_resource_nodes_count;\n")
-    string(APPEND RESOURCE_TREE_H_CONTENT "extern const int g_resource_root_index;\n\n")
-    string(APPEND RESOURCE_TREE_H_CONTENT "#ifdef __cplusplus\n}\n#endif\n\n#endif\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "extern const int g_resource_root_index;\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "extern const int g_resource_sorted[];\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "extern const unsigned int g_resource_sorted_count;\n\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "// Node of a file or directory by its path relative to the resource root (\"ui/icons/play.png\",\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "// \"ui\"), or NULL. Binary search over g_resource_sorted; no allocation.\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "const ResourceNode* findResource(const char* path);\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "// Same for a path of `len` bytes that need not be 0-terminated.\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "const ResourceNode* findResourceN(const char* path, size_t len);\n\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "#ifdef __cplusplus\n}\n\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "inline const ResourceNode* findResource(std::string_view path) {\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "  return findResourceN(path.data(), path.size());\n")
+    string(APPEND RESOURCE_TREE_H_CONTENT "}\n#endif\n\n#endif\n")
 
     set(RESOURCE_TREE_C_CONTENT "// Auto-generated resource tree\n\n")
     string(APPEND RESOURCE_TREE_C_CONTENT "#include <stddef.h>\n")
+    string(APPEND RESOURCE_TREE_C_CONTENT "#include <string.h>\n")
     string(APPEND RESOURCE_TREE_C_CONTENT "#include \"resource_tree.h\"\n")
     string(APPEND RESOURCE_TREE_C_CONTENT "#include \"resources.h\"\n\n")
     string(APPEND RESOURCE_TREE_C_CONTENT "const ResourceNode g_resource_nodes[] = {\n")
@@ -221,6 +400,8 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
         list(GET NODE_ISDIRS ${i} NODE_ISDIR)
         list(GET NODE_DATASYMS ${i} NODE_DATASYM)
         list(GET NODE_LENS ${i} NODE_LEN)
+        list(GET NODE_SIZES ${i} NODE_SIZE)
+        list(GET NODE_FORMATS ${i} NODE_FORMAT)
         list(GET NODE_PARENTS ${i} NODE_PARENT)
         list(GET NODE_FIRST_CHILD ${i} NODE_FIRST)
         list(GET NODE_NEXT_SIBLING ${i} NODE_NEXT)
@@ -233,18 +414,48 @@ function(embed_resources RESOURCE_DIR OUT_VAR)
         if(NODE_ISDIR)
             set(DATA_PTR "NULL")
             set(LEN_EXPR "NULL")
+            set(SIZE_EXPR "NULL")
         else()
             set(DATA_PTR "(const unsigned char*)${NODE_DATASYM}")
             set(LEN_EXPR "&${NODE_LEN}")
+            set(SIZE_EXPR "&${NODE_SIZE}")
         endif()
 
         string(APPEND RESOURCE_TREE_C_CONTENT
-            "  {\"${NODE_NAME_ESC}\", \"${NODE_PATH_ESC}\", ${DATA_PTR}, ${LEN_EXPR}, ${NODE_PARENT}, ${NODE_FIRST}, ${NODE_NEXT}, ${NODE_ISDIR}},\n")
+            "  {\"${NODE_NAME_ESC}\", \"${NODE_PATH_ESC}\", ${DATA_PTR}, ${LEN_EXPR}, ${SIZE_EXPR}, ${NODE_PARENT}, ${NODE_FIRST}, ${NODE_NEXT}, ${NODE_ISDIR}, ${NODE_FORMAT}},\n")
     endforeach()
 
     string(APPEND RESOURCE_TREE_C_CONTENT "};\n")
     string(APPEND RESOURCE_TREE_C_CONTENT "const unsigned int g_resource_nodes_count = ${NODE_COUNT};\n")
-    string(APPEND RESOURCE_TREE_C_CONTENT "const int g_resource_root_index = ${ROOT_INDEX};\n")
+    string(APPEND RESOURCE_TREE_C_CONTENT "const int g_resource_root_index = ${ROOT_INDEX};\n\n")
+    string(APPEND RESOURCE_TREE_C_CONTENT "const int g_resource_sorted[] = {${SORTED_INDICES}};\n")
+    string(APPEND RESOURCE_TREE_C_CONTENT "const unsigned int g_resource_sorted_count = ${SORTED_COUNT};\n\n")
+    string(APPEND RESOURCE_TREE_C_CONTENT [=[
+const ResourceNode* findResourceN(const char* path, size_t len) {
+  // No resource path holds a NUL, and strncmp would stop at one before comparing len bytes.
+  if (len && memchr(path, 0, len))
+    return NULL;
+  unsigned int lo = 0, hi = g_resource_sorted_count;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    const ResourceNode* node = &g_resource_nodes[g_resource_sorted[mid]];
+    int c = strncmp(node->path, path, len);
+    if (c == 0 && node->path[len])
+      c = 1;
+    if (c == 0)
+      return node;
+    if (c < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return NULL;
+}
+
+const ResourceNode* findResource(const char* path) {
+  return findResourceN(path, strlen(path));
+}
+]=])
 
     file(WRITE "${RESOURCE_TREE_H}" "${RESOURCE_TREE_H_CONTENT}")
     file(WRITE "${RESOURCE_TREE_C}" "${RESOURCE_TREE_C_CONTENT}")
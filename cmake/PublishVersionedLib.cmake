@@ -0,0 +1,30 @@
+# Publishes LIB_FILE as <LIB_DIR>/<LIB_PREFIX><LIB_NAME>.<n><LIB_SUFFIX>, where n grows by one
+# with every build. The library is renamed into place first and the generation file last, so
+# a host watching <LIB_NAME>.generation never sees a number whose library is incomplete.
+#
+# Usage: cmake -DLIB_FILE=... -DLIB_DIR=... -DLIB_PREFIX=... -DLIB_SUFFIX=... -DLIB_NAME=... -P PublishVersionedLib.cmake
+
+set(GENERATION_FILE "${LIB_DIR}/${LIB_NAME}.generation")
+set(GENERATION 0)
+if (EXISTS "${GENERATION_FILE}")
+    file(READ "${GENERATION_FILE}" GENERATION)
+    string(STRIP "${GENERATION}" GENERATION)
+    if (NOT GENERATION MATCHES "^[0-9]+$")
+        set(GENERATION 0)
+    endif()
+endif()
+math(EXPR GENERATION "${GENERATION} + 1")
+
+set(PUBLISHED_LIB "${LIB_DIR}/${LIB_PREFIX}${LIB_NAME}.${GENERATION}${LIB_SUFFIX}")
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E copy "${LIB_FILE}" "${PUBLISHED_LIB}.tmp"
+    RESULT_VARIABLE COPY_RESULT
+)
+if (NOT COPY_RESULT EQUAL 0)
+    message(FATAL_ERROR "Failed to copy ${LIB_FILE} to ${PUBLISHED_LIB}.tmp")
+endif()
+file(RENAME "${PUBLISHED_LIB}.tmp" "${PUBLISHED_LIB}")
+
+file(WRITE "${GENERATION_FILE}.tmp" "${GENERATION}\n")
+file(RENAME "${GENERATION_FILE}.tmp" "${GENERATION_FILE}")
+message(STATUS "Published ${PUBLISHED_LIB}")
@@ -1,121 +1,462 @@
+#include <algorithm>
 #include <cstddef>
 #include <filesystem>
 #include <math.h>
 #include <string>
 #include <time.h>
-#include <functional>
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 
 #include "raylib.h"
 
 #include "../game/src/game.h"
+#include "game_api.h"
+#include "game_lib.h"
+#include "game_cases.h"
+#include "game_recorder.h"
 #include "util/zpp_bits.h"
-
-#define NOGDI
-#define NOUSER
-#include <dylib.hpp>
+#include "util/lib_watcher.h"
+#include "util/lib_loader.h"
+#include "util/state_ring.h"
+#include "util/mapped_file.h"
+#include "util/save_worker.h"
+#include "util/save_container.h"
+#include "util/save_reader.h"
+#include "util/frame_profiler.h"
 
 #include "resources.h"
 
-const std::string LIB_NAME = "GAME";
-#if defined(_WIN32)
-const std::string LIB_PATH = "..\\game\\build\\";
-const std::string LIB_PREFIX = "";
-const std::string LIB_EXT = ".dll";
-#elif defined(__linux__)
-const std::string LIB_PATH = "../game/build/";
-const std::string LIB_PREFIX = "lib";
-const std::string LIB_EXT = ".so";
+#if defined(GAME_BASE_VERSIONED_RELOAD)
+const bool VERSIONED_RELOAD = true;
+#else
+const bool VERSIONED_RELOAD = false;
 #endif
-const std::string NEW_LIB_POSTFIX = "_NEW";
 const int TARGET_FPS = 60;
-
-struct GameCase {
-    GameState gs = GameState();
-    std::vector<AutomationEvent> events;
-};
-
-struct GameCasesState {
-    std::vector<GameCase> gameCases;
-    bool recording = false;
-    int replaying = false;
-    int casen = -1;
-    int frame = 0;
-    int aelframe = 0;
-};
+const int SIM_HZ = 120;
+const float SIM_DT = 1.0f / SIM_HZ;
+const float MAX_FRAME_TIME = 0.25f;
+const int PROFILE_FRAMES = 1024;
+const int PROFILE_STATS_FRAMES = TARGET_FPS * 4;
+const int PROFILE_OVERLAY_REFRESH = TARGET_FPS / 2;
+const std::string PROFILE_TRACE_NAME = "frames";
+const int REWIND_SECONDS = 60 * 2;
+const int REWIND_KEYFRAME_SECONDS = 1;
+const int REPLAY_KEYFRAME_SECONDS = 5;
+const int REPLAY_HASH_INTERVAL = 1;
+const bool RECORD_STREAM = false;
+const std::string RECORD_STREAM_EXT = ".events";
+const bool SAVE_FSYNC = false;
+const std::string SAVE_CONTAINER = "saves";
+const std::string DEFAULT_SAVE_SLOT = "state";
+const SaveCodecId DEFAULT_SAVE_CODEC = SAVE_CODEC_FAST;
 
 struct BaseState {
     Vector2 winSz, baseWinSz;
     std::string libPath, libName;
-    std::function<void(GameAssets&, GameState&)> gameInit;
-    std::function<void(GameState&)> gameReset;
-    std::function<void(GameState&, const GameState&)> gameSetState;
-    std::function<void(GameState&)> gameUpdateAndDraw;
-    std::filesystem::path gameLibDir, gameLibName, gameNewLibName, gameLibFile, gameNewLibFile, gameLibFullPath, gameNewLibFullPath;
-    dylib lib;
+    std::filesystem::path gameLibDir, gameLibName, gameNewLibName, gameLibFile, gameNewLibFile, gameLibFullPath, gameNewLibFullPath, gameGenerationFullPath;
+    int libGeneration = 0;
+    std::unique_ptr<GameLib> game;
+    GameApi api;
+    LibWatcher watcher;
+    LibLoader<GameLib> loader;
 
     GameCasesState gcs;
+    GameCaseIndex replayIndex;
+    std::vector<std::byte> hashBuffer;
     AutomationEventList ael;
+    GameCaseRecorder recorder;
+    int finishedCase = -1;  // case whose events the recorder is still assembling
+    GameInput input;
+    FrameProfiler profiler;
+    bool profileOverlay = false;
+
+    StateRing<GameState> history;
+    GameState rewindState;
+    bool rewinding = false;
+    SaveContainer saves;
+    SaveWorker saver;
+    std::vector<std::byte> loadBuffer;
+    std::uint64_t frame = 0;
 
     BaseState(const std::string& libPath, const std::string& libName) :
         libPath(libPath),
         libName(libName),
         gameLibDir(std::filesystem::current_path() / libPath),
         gameLibName(libName),
-        gameLibFile(LIB_PREFIX + libName + LIB_EXT),
         gameNewLibName(libName + NEW_LIB_POSTFIX),
+        gameLibFile(LIB_PREFIX + libName + LIB_EXT),
         gameNewLibFile(LIB_PREFIX + libName + NEW_LIB_POSTFIX + LIB_EXT),
         gameLibFullPath(gameLibDir / gameLibFile),
         gameNewLibFullPath(gameLibDir / gameNewLibFile),
-        lib(gameLibDir.string(), (std::filesystem::exists(gameLibFullPath) ? gameLibName : gameNewLibName).string())
+        gameGenerationFullPath(gameLibDir / (libName + GENERATION_FILE_EXT)),
+        watcher(VERSIONED_RELOAD ? gameGenerationFullPath : gameNewLibFullPath),
+        loader([this] { return loadNewLib(); }, [this](std::unique_ptr<GameLib> old) { unloadLib(std::move(old)); }),
+        ael(LoadAutomationEventList(0)),
+        profiler(PROFILE_FRAMES),
+        history(1),   // sized by sizeHistory() once the library is loaded
+        saves(SAVE_CONTAINER)
     {
-        setFunc();
+        // The first generation is loaded synchronously so that init() runs on the newest build.
+        game = loadNewLib();
+        if (!game)
+            game = std::make_unique<GameLib>(dylib(gameLibDir.string(), (std::filesystem::exists(gameLibFullPath) ? gameLibName : gameNewLibName).string()));
+        api = game->api;
+        sizeHistory();
+        watcher.start();
+        loader.start();
+        registerSaveCodecs();
+        saver.durable = SAVE_FSYNC;
+        // Without a container saves fall back to loose files named by their slot, which
+        // readSave() also finds.
+        if (saves.open()) {
+            saver.write = [this](const std::string& slot, std::uint64_t frame, std::span<const std::byte> bytes) {
+                return saves.write(slot, frame, bytes, saver.durable);
+            };
+        } else {
+            std::cerr << "Failed to open save container " << SAVE_CONTAINER << ", saving to loose files" << std::endl;
+        }
+        saver.onError = [](const std::string& slot, const std::string& error) {
+            std::cerr << "Failed to save " << slot << ": " << error << std::endl;
+        };
+        saver.start();
+    }
+
+    ~BaseState() {
+        UnloadAutomationEventList(ael);
+        saver.stop();
+        watcher.stop();
+        loader.stop();
+        // In versioned mode the loaded generation is the published file that GAME.generation
+        // names and the next start loads, so it is kept; GAME_NEW staging copies are not needed.
+        if (VERSIONED_RELOAD)
+            game.reset();
+        else
+            unloadLib(std::move(game));
+    }
+
+    void gameInit(GameAssets& ga, GameState& gs) { api.init(ga, gs); }
+    void gameReset(GameState& gs) { api.reset(gs); }
+    void gameSetState(GameState& gs, const GameState& ngs) { api.setState(gs, ngs); }
+    void gameUpdateAndDraw(GameState& gs) { api.updateAndDraw(gs); }
+    void gameSetInput() { if (api.setInput) api.setInput(input); }
+    void gameDraw(const GameState& gs, float alpha) { api.draw(gs, alpha); }
+
+    // Libraries with separate update() and draw() run on a fixed timestep.
+    bool fixedStep() const { return api.update && api.draw; }
+
+    // Simulation steps per second, which rewind, recording and replay count in.
+    int stepRate() const { return fixedStep() ? SIM_HZ : TARGET_FPS; }
+
+    int replayKeyframeInterval() const { return REPLAY_KEYFRAME_SECONDS * stepRate(); }
+
+    // The rewind history holds REWIND_SECONDS of steps, so it is rebuilt (and emptied) when a
+    // reload changes the step rate.
+    void sizeHistory() {
+        auto capacity = std::size_t(REWIND_SECONDS * stepRate());
+        if (history.capacity != capacity)
+            history = StateRing<GameState>(capacity, std::size_t(REWIND_KEYFRAME_SECONDS * stepRate()));
     }
 
-    void setFunc() {
-        gameInit = lib.get_function<void(GameAssets&, GameState&)>("init");
-        gameReset = lib.get_function<void(GameState&)>("reset");
-        gameSetState = lib.get_function<void(GameState&, const GameState&)>("setState");
-        gameUpdateAndDraw = lib.get_function<void(GameState&)>("updateAndDraw");
+    // One simulation step: replay or record its input, then run the game. Recording and replay
+    // count these steps, so with a fixed timestep they are independent of the render rate.
+    void simStep(GameState& gs) {
+        if (gcs.replaying)
+            replayFrame();
+        else if (gcs.recording)
+            recordFrame(gs);
+        gameSetInput();
+        if (fixedStep())
+            api.update(gs);
+        else
+            gameUpdateAndDraw(gs);
+        stepGameInput(input);
+        captureFrame(gs);
+        frame++;
     }
 
-    void reloadLib() {
-        lib = dylib(libPath, libName);
-        setFunc();
+    // Runs on the loader thread; nothing here touches the render thread.
+    std::unique_ptr<GameLib> loadNewLib() {
+        return VERSIONED_RELOAD ? loadPublishedLib() : loadStagedLib();
+    }
+
+    std::filesystem::path versionedLibPath(int generation) const {
+        return gameLibDir / (LIB_PREFIX + libName + "." + std::to_string(generation) + LIB_EXT);
+    }
+
+    // Generation number of a file named <prefix><name>.<n><ext>, or -1.
+    int versionedLibGeneration(const std::filesystem::path& file) const {
+        auto name = file.filename().string();
+        auto head = LIB_PREFIX + libName + ".";
+        if (name.size() <= head.size() + LIB_EXT.size() || name.compare(0, head.size(), head) || name.compare(name.size() - LIB_EXT.size(), LIB_EXT.size(), LIB_EXT))
+            return -1;
+        auto digits = name.substr(head.size(), name.size() - head.size() - LIB_EXT.size());
+        if (digits.find_first_not_of("0123456789") != std::string::npos)
+            return -1;
+        return std::stoi(digits);
+    }
+
+    // Highest generation of a published library in the library directory, or -1.
+    int newestPublishedGeneration() const {
+        int newest = -1;
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(gameLibDir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+            newest = std::max(newest, versionedLibGeneration(it->path()));
+        return newest;
+    }
+
+    // Versioned mode: the build publishes <prefix>GAME.<n><ext> and then bumps GAME.generation.
+    // The published file is loaded where it lies, so no bytes are copied, and generations that
+    // were published but never loaded are collected right away. If the recorded generation's
+    // file is gone (or nothing is recorded), the newest published file still present is used.
+    std::unique_ptr<GameLib> loadPublishedLib() {
+        int published = 0;
+        std::ifstream(gameGenerationFullPath) >> published;
+        auto path = versionedLibPath(published);
+        std::error_code ec;
+        if (published <= 0 || !std::filesystem::exists(path, ec)) {
+            published = newestPublishedGeneration();
+            path = versionedLibPath(published);
+        }
+        if (published <= libGeneration)
+            return nullptr;
+        std::unique_ptr<GameLib> next;
+        try {
+            next = std::make_unique<GameLib>(dylib(path), path);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load " << path << ": " << e.what() << std::endl;
+            return nullptr;
+        }
+        for (auto it = std::filesystem::directory_iterator(gameLibDir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            int generation = versionedLibGeneration(it->path());
+            std::error_code removeEc;
+            if (generation > libGeneration && generation < published)
+                std::filesystem::remove(it->path(), removeEc);
+        }
+        libGeneration = published;
+        return next;
+    }
+
+    // GAME_NEW is moved to a per-generation name so it can be loaded while the previous
+    // generation is still mapped, then copied back to GAME so the next start picks it up.
+    std::unique_ptr<GameLib> loadStagedLib() {
+        std::error_code ec;
+        if (!std::filesystem::exists(gameNewLibFullPath, ec))
+            return nullptr;
+        auto staged = versionedLibPath(++libGeneration);
+        std::filesystem::remove(staged, ec);
+        std::filesystem::rename(gameNewLibFullPath, staged, ec);
+        if (ec) {
+            std::cerr << "Failed to stage " << gameNewLibFullPath << ": " << ec.message() << std::endl;
+            return nullptr;
+        }
+        std::unique_ptr<GameLib> next;
+        try {
+            next = std::make_unique<GameLib>(dylib(staged), staged);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to load " << staged << ": " << e.what() << std::endl;
+            std::filesystem::remove(staged, ec);
+            return nullptr;
+        }
+        // GAME may be the mapped image of a running generation: unlink before writing a new file.
+        std::filesystem::remove(gameLibFullPath, ec);
+        std::filesystem::copy_file(staged, gameLibFullPath, ec);
+        return next;
+    }
+
+    void unloadLib(std::unique_ptr<GameLib> old) {
+        if (!old)
+            return;
+        auto staged = old->stagedPath;
+        old.reset();
+        std::error_code ec;
+        if (!staged.empty())
+            std::filesystem::remove(staged, ec);
     }
 
     void checkLoadLib() {
-        if (std::filesystem::exists(gameNewLibFullPath)) {
-            lib = dylib(gameNewLibFullPath);
-            std::filesystem::remove(gameLibFullPath);
-            std::filesystem::copy_file(gameNewLibFullPath, gameLibFullPath);
-            reloadLib();
-            std::filesystem::remove(gameNewLibFullPath);
+        if (watcher.consume())
+            loader.request();
+        if (auto next = loader.take()) {
+            loader.retire(std::exchange(game, std::move(next)));
+            api = game->api;
+            sizeHistory();
+        }
+    }
+
+    // While recording, the hash of the state the next frame starts from is taken from the bytes
+    // the rewind history has just serialized instead of serializing the state again.
+    void captureFrame(const GameState& gs) {
+        bool captured = !rewinding && history.capture(gs);
+        if (gcs.recording && gcs.frame % REPLAY_HASH_INTERVAL == 0)
+            gcs.gameCases.at(gcs.casen).hashes.push_back(captured ? StateHash::hash(history.newest()) : hashGameState(gs, hashBuffer));
+    }
+
+    // Restores the state from `steps` frames before the last captured one.
+    bool rewind(GameState& gs, std::size_t steps = 1) {
+        if (!history.rewind(steps, rewindState))
+            return false;
+        gameSetState(gs, rewindState);
+        return true;
+    }
+
+    void startReplay(GameState& gs, int casen) {
+        collectRecording(true);
+        gcs.replaying = true;
+        gcs.casen = casen;
+        replayIndex.build(gcs.gameCases.at(casen));
+        seekReplay(gs, 0);
+    }
+
+    // Moves the replay to the start of `frame` through the nearest keyframe.
+    void seekReplay(GameState& gs, int frame) {
+        auto& gc = gcs.gameCases.at(gcs.casen);
+        // Fast-forwarding through updateAndDraw() presents frames; don't wait for vsync pacing on them.
+        SetTargetFPS(0);
+        gcs.frame = int(seekGameCase(api, gs, gc, replayIndex, unsigned(std::max(frame, 0))));
+        SetTargetFPS(TARGET_FPS);
+        gcs.aelframe = int(replayIndex.offset(unsigned(gcs.frame)));
+        if (unsigned(gcs.frame) >= replayIndex.frames()) {
+            gcs.replaying = false;
+            gcs.frame = 0;
+        }
+    }
+
+    // raylib's list only has to hold the events of one step: recordFrame() drains it every step.
+    void startRecording(const GameState& gs) {
+        if (gcs.recording)
+            stopRecording();
+        collectRecording(true);
+        gcs.replaying = false;
+        gcs.recording = true;
+        gcs.frame = 0;
+        gcs.casen = int(gcs.gameCases.size());
+        gcs.gameCases.push_back(GameCase());
+        gcs.gameCases.back().gs = gs;
+        gcs.gameCases.back().hashInterval = REPLAY_HASH_INTERVAL;
+        gcs.gameCases.back().hashes.push_back(hashGameState(gs, hashBuffer));
+        recorder.start(RECORD_STREAM ? std::filesystem::path("case" + std::to_string(gcs.casen + 1) + RECORD_STREAM_EXT) : std::filesystem::path());
+        ael.count = 0;
+        SetAutomationEventList(&ael);
+        SetAutomationEventBaseFrame(0);
+        StartAutomationEventRecording();
+    }
+
+    void stopRecording() {
+        StopAutomationEventRecording();
+        recorder.drain(ael, unsigned(gcs.frame));
+        recorder.finish();
+        finishedCase = gcs.casen;
+        gcs.recording = false;
+    }
+
+    // Moves the events of the last recording into its case once the recorder has assembled
+    // them. Polled every frame; anything that reads or replaces the cases waits for it.
+    void collectRecording(bool wait = false) {
+        if (finishedCase >= 0 && recorder.take(gcs.gameCases.at(finishedCase).events, wait))
+            finishedCase = -1;
+    }
+
+    // Recording counts steps from 0, stamps the raylib events drained each step with that
+    // count so replay and seeking apply them at the same step, keeps a keyframe every
+    // REPLAY_KEYFRAME_SECONDS of steps for seeking, a state hash every REPLAY_HASH_INTERVAL
+    // frames for finding divergences (taken in captureFrame()) and the host input of every frame.
+    void recordFrame(const GameState& gs) {
+        auto& gc = gcs.gameCases.at(gcs.casen);
+        if (gcs.frame > 0 && gcs.frame % replayKeyframeInterval() == 0)
+            captureKeyframe(gc, unsigned(gcs.frame), gs);
+        recorder.drain(ael, unsigned(gcs.frame));
+        gc.input.record(unsigned(gcs.frame), input);
+        gcs.frame++;
+    }
+
+    // Plays the input recorded for the current replay frame: the host input snapshot if the
+    // library takes it (the live input then never reaches the game), otherwise the raylib
+    // events. The replay ends after the last recorded frame.
+    void replayFrame() {
+        auto& gc = gcs.gameCases.at(gcs.casen);
+        if (api.setInput && !gc.input.empty()) {
+            gc.input.get(unsigned(gcs.frame), input);
+        } else {
+            replayIndex.forEachAt(unsigned(gcs.frame), PlayAutomationEvent);
+            captureInputFrame(input.now);
+        }
+        if (unsigned(++gcs.frame) >= replayIndex.frames()) {
+            gcs.replaying = false;
+            gcs.frame = 0;
         }
+        gcs.aelframe = int(replayIndex.offset(unsigned(gcs.frame)));
+    }
+
+    // The high-ratio save codec is raylib's DEFLATE; the fast one is built in.
+    static void registerSaveCodecs() {
+        SaveCodec deflate;
+        deflate.compress = [](std::span<const std::byte> in, std::vector<std::byte>& out) {
+            int size = 0;
+            unsigned char* data = CompressData((const unsigned char*)in.data(), int(in.size()), &size);
+            if (!data)
+                return false;
+            out.insert(out.end(), (const std::byte*)data, (const std::byte*)data + size);
+            MemFree(data);
+            return true;
+        };
+        deflate.decompress = [](std::span<const std::byte> in, std::span<std::byte> out) {
+            int size = 0;
+            unsigned char* data = DecompressData((const unsigned char*)in.data(), int(in.size()), &size);
+            bool ok = data && std::size_t(size) == out.size();
+            if (ok)
+                memcpy(out.data(), data, out.size());
+            MemFree(data);
+            return ok;
+        };
+        SaveCompression::registerCodec(SAVE_CODEC_HIGH, deflate);
     }
 
-    void saveState(GameState& gs, const std::string& name = "") {
-        auto [data, out] = zpp::bits::data_out();
-        auto _ = out(gs, gcs);
-        std::ofstream o(name.length() ? name : "state", std::ios::binary);
-        o.write((const char*) data.data(), data.size());
-        o.close();
+    // Only serialization happens here; compression and the write run on the save worker.
+    void saveState(GameState& gs, const std::string& name = "", SaveCodecId codec = DEFAULT_SAVE_CODEC) {
+        auto timed = profiler.scope(FrameProfiler::PHASE_SAVE);
+        collectRecording(true);
+        saver.save(name.length() ? name : DEFAULT_SAVE_SLOT, frame, codec, gs, gcs);
     }
 
     void loadState(GameAssets& ga, GameState& gs, const std::string& name = "") {
-        auto [data, in] = zpp::bits::data_in();
-        auto filename = name.length() ? name : "state";
-        uintmax_t file_size = std::filesystem::file_size(filename);
-        std::ifstream i(filename, std::ios::binary);
-        data.resize(file_size);
-        i.seekg(0, std::ios::beg);
-        i.read(reinterpret_cast<char*>(data.data()), data.size());
+        saver.wait();
+        if (gcs.recording)
+            stopRecording();
+        collectRecording(true);
         GameState ngs;
-        auto _ = in(ngs, gcs);
+        if (!readSave(saves, name.length() ? name : DEFAULT_SAVE_SLOT, loadBuffer, ngs, gcs))
+            return;
         gameSetState(gs, ngs);
+        // A save taken mid-recording holds only the events up to the last finished recording.
+        gcs.recording = false;
+        // A save taken mid-replay continues from the frame it was taken at.
+        if (gcs.replaying && gcs.casen >= 0 && gcs.casen < int(gcs.gameCases.size())) {
+            replayIndex.build(gcs.gameCases[gcs.casen]);
+            gcs.aelframe = int(replayIndex.offset(unsigned(gcs.frame)));
+        } else {
+            gcs.replaying = false;
+        }
+    }
+
+    std::vector<SaveSlot> listSaves() {
+        return saves.list();
+    }
+
+    // The game draws the whole frame itself, so the summary goes to the window title.
+    void showProfile() {
+        if (profileOverlay && profiler.frames % PROFILE_OVERLAY_REFRESH == 0)
+            SetWindowTitle((WIN_NOM + profiler.summary(PROFILE_STATS_FRAMES)).c_str());
     }
+
+    void toggleProfile() {
+        profileOverlay = !profileOverlay;
+        if (!profileOverlay)
+            SetWindowTitle(WIN_NOM);
+    }
+
 };
 
 void initWindow() {
@@ -133,6 +474,8 @@ void initWindow() {
 void processInput(BaseState& bs, GameAssets& ga, GameState& gs) 
 {
     PollInputEvents();
+    captureGameInput(bs.input);
+    bs.collectRecording();
 
     if (IsKeyPressed(KEY_F) || IsKeyPressed(KEY_F11) || (IsKeyPressed(KEY_ENTER) && (IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT)))) {
         if (!IsWindowFullscreen()) {
@@ -156,30 +499,12 @@ void processInput(BaseState& bs, GameAssets& ga, GameState& gs)
     }
 
     if (IsKeyPressed(KEY_LEFT_BRACKET)) {
-        if (bs.gcs.recording)
-            StopAutomationEventRecording();
-        bs.gcs.replaying = false;
-        bs.gcs.recording = true;
-        bs.gcs.casen = bs.gcs.gameCases.size();
-        bs.gcs.gameCases.push_back(GameCase());
-        bs.gcs.gameCases.back().gs = gs;
-        bs.ael = LoadAutomationEventList(0);
-        SetAutomationEventList(&bs.ael);
-        SetAutomationEventBaseFrame(0);
-        StartAutomationEventRecording();
+        bs.startRecording(gs);
     } else if (IsKeyPressed(KEY_RIGHT_BRACKET)) {
         if (bs.gcs.recording) {
-            StopAutomationEventRecording();
-            auto& events = bs.gcs.gameCases[bs.gcs.casen].events;
-            events = std::vector<AutomationEvent>(bs.ael.count);
-            memcpy(events.data(), bs.ael.events, sizeof(AutomationEvent) * bs.ael.count);
-            bs.gcs.recording = false;        
-        } else if (bs.gcs.casen < bs.gcs.gameCases.size()) {
-            bs.gcs.replaying = true;
-            bs.gameSetState(gs, bs.gcs.gameCases.at(bs.gcs.casen).gs);
-            bs.gcs.frame = 0;
-            bs.gcs.aelframe = 0;
-            ResetInputState();
+            bs.stopRecording();
+        } else if (bs.gcs.casen >= 0 && bs.gcs.casen < bs.gcs.gameCases.size()) {
+            bs.startReplay(gs, bs.gcs.casen);
         }
     }
 
@@ -188,28 +513,27 @@ void processInput(BaseState& bs, GameAssets& ga, GameState& gs)
     if (digitPressed) {
         int casen = std::stoi(std::string{(char)(key)}) - 1;
         if (casen < 0) casen = 9;
-        if (casen < bs.gcs.gameCases.size()) {
-            bs.gcs.replaying = true;
-            bs.gcs.casen = casen;
-            bs.gameSetState(gs, bs.gcs.gameCases.at(casen).gs);
-            bs.gcs.frame = 0;
-            bs.gcs.aelframe = 0;
-            ResetInputState();
-        }
+        if (casen < bs.gcs.gameCases.size())
+            bs.startReplay(gs, casen);
     }
 
+    // F9 shows p50/p99/max milliseconds per phase, F10 writes the recent frames as CSV and trace.
+    if (IsKeyPressed(KEY_F9))
+        bs.toggleProfile();
+    if (IsKeyPressed(KEY_F10))
+        bs.profiler.dump(PROFILE_TRACE_NAME);
+
+    // Holding backspace steps back one captured frame per frame; at the oldest one it holds still.
+    bs.rewinding = !bs.gcs.replaying && !bs.gcs.recording && IsKeyDown(KEY_BACKSPACE);
+    if (bs.rewinding && !bs.rewind(gs, 1))
+        bs.rewind(gs, 0);
+
     if (bs.gcs.replaying) {
-        auto& events = bs.gcs.gameCases.at(bs.gcs.casen).events;
-        while (bs.gcs.frame == events[bs.gcs.aelframe].frame) {
-            PlayAutomationEvent(events[bs.gcs.aelframe]);
-            bs.gcs.aelframe++;
-            if (bs.gcs.aelframe == events.size()) {
-                bs.gcs.replaying = false;
-                bs.gcs.frame = 0;
-                bs.gcs.aelframe = 0;
-            }
-        }
-        bs.gcs.frame++;
+        // Page up/down scrub the replay by one keyframe interval.
+        if (IsKeyPressed(KEY_PAGE_DOWN))
+            bs.seekReplay(gs, bs.gcs.frame + bs.replayKeyframeInterval());
+        else if (IsKeyPressed(KEY_PAGE_UP))
+            bs.seekReplay(gs, bs.gcs.frame - bs.replayKeyframeInterval());
     } else {
         if (IsKeyPressed(KEY_S)/* || IsKeyPressed(KEY_SPACE)*/)
             bs.saveState(gs);
@@ -232,11 +556,39 @@ int main()
     bs.checkLoadLib();
     bs.gameInit(ga, gs);
 
+    float accumulator = 0;
     while (!WindowShouldClose()) {
-        bs.checkLoadLib();
-        processInput(bs, ga, gs);
+        // Swapping and frame pacing happen in the game's EndDrawing(), so they count towards
+        // update (one updateAndDraw() per frame) or draw (fixed timestep).
+        bs.profiler.beginFrame();
+        {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_RELOAD);
+            bs.checkLoadLib();
+        }
+        {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_INPUT);
+            processInput(bs, ga, gs);
+        }
 
-        bs.gameUpdateAndDraw(gs);
+        if (!bs.fixedStep()) {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_UPDATE);
+            bs.simStep(gs);
+        } else {
+            // Simulate in SIM_DT steps for the time the last frame took (capped, so a stall
+            // doesn't snowball) and draw in between. Steps after the first in a frame see no
+            // new input edges; frames without a step pass theirs on to the next one that runs.
+            accumulator += std::min(GetFrameTime(), MAX_FRAME_TIME);
+            bs.input.frameTime = SIM_DT;
+            while (accumulator >= SIM_DT) {
+                auto timed = bs.profiler.scope(FrameProfiler::PHASE_UPDATE);
+                bs.simStep(gs);
+                accumulator -= SIM_DT;
+            }
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_DRAW);
+            bs.gameDraw(gs, accumulator / SIM_DT);
+        }
+        bs.profiler.endFrame();
+        bs.showProfile();
     }
 
     CloseWindow();
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../game/src/game.h"
+#include "game_input.h"
+
+// Entry points the shared host calls into the game library. The library exports a single
+// getGameApi() returning a static table; the host checks `version` and `size` on load and
+// then calls straight through the function pointers. Bump GAME_API_VERSION whenever a
+// signature changes; appending a member only needs `size` to grow. Members after
+// updateAndDraw are optional: the host zero-fills whatever an older library did not export
+// and checks them for null before calling.
+#define GAME_API_VERSION 1
+
+#if defined(_WIN32)
+#define GAME_API_EXPORT_ATTR __declspec(dllexport)
+#else
+#define GAME_API_EXPORT_ATTR __attribute__((visibility("default")))
+#endif
+
+struct GameApi {
+    uint32_t version;
+    uint32_t size;
+    void (*init)(GameAssets&, GameState&);
+    void (*reset)(GameState&);
+    void (*setState)(GameState&, const GameState&);
+    void (*updateAndDraw)(GameState&);
+    // Optional. Advances the simulation by one frame without drawing (headless replay).
+    void (*update)(GameState&);
+    // Optional. Called before every update with the host's input snapshot, live or replayed.
+    void (*setInput)(const GameInput&);
+    // Optional. With update() it switches the host to a fixed timestep: update() runs at the
+    // simulation rate and draw() once per rendered frame, `alpha` being how far the render
+    // time is between the last simulated step and the next one.
+    void (*draw)(const GameState&, float alpha);
+};
+
+// Size of the table every library has to export; later members are optional.
+#define GAME_API_REQUIRED_SIZE offsetof(GameApi, update)
+
+using GetGameApiFn = const GameApi*();
+
+// Used once in the game library, e.g. GAME_API_EXPORT(init, reset, setState, updateAndDraw)
+// or, with the optional entries, GAME_API_EXPORT(init, reset, setState, updateAndDraw, update, setInput, draw)
+#define GAME_API_EXPORT(initFn, resetFn, setStateFn, updateAndDrawFn, ...) \
+    extern "C" GAME_API_EXPORT_ATTR const GameApi* getGameApi() { \
+        static const GameApi api = {GAME_API_VERSION, sizeof(GameApi), initFn, resetFn, setStateFn, updateAndDrawFn __VA_OPT__(,) __VA_ARGS__}; \
+        return &api; \
+    }
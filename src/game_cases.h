@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "raylib.h"
+
+#include "../game/src/game.h"
+#include "game_api.h"
+#include "game_input.h"
+#include "util/zpp_bits.h"
+#include "util/state_hash.h"
+
+// Recorded events in a packed form. Per event: a varint frame delta to the previous event, a
+// varint of type * 5 + number of params kept (trailing zero params are dropped) and the kept
+// params as zig-zag varints. A key or mouse button event takes 3 bytes instead of 24. Events
+// are kept in frame order; they are decoded only while replaying.
+struct PackedEvents {
+    static constexpr std::uint32_t PARAMS = sizeof(AutomationEvent::params) / sizeof(AutomationEvent::params[0]);
+
+    std::vector<std::byte> bytes;
+    std::uint32_t count = 0;
+    std::uint32_t lastFrame = 0;
+
+    void clear() {
+        bytes.clear();
+        count = 0;
+        lastFrame = 0;
+    }
+
+    // Number of frames a replay of these events runs for: through the frame of the last one.
+    unsigned frames() const {
+        return count ? lastFrame + 1 : 0;
+    }
+
+    void append(const AutomationEvent& e) {
+        if (count && e.frame < lastFrame) {
+            insert(e);
+            return;
+        }
+        encode(bytes, count ? e.frame - lastFrame : e.frame, e);
+        lastFrame = e.frame;
+        count++;
+    }
+
+    void assign(std::span<const AutomationEvent> events) {
+        std::vector<AutomationEvent> sorted(events.begin(), events.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](const AutomationEvent& a, const AutomationEvent& b) { return a.frame < b.frame; });
+        clear();
+        for (auto& e : sorted)
+            append(e);
+    }
+
+    // Decodes the event at `offset` and moves `offset` past it. `e.frame` is set to the delta
+    // to the previous event.
+    bool decode(std::size_t& offset, AutomationEvent& e) const {
+        zpp::bits::in in(bytes);
+        in.reset(offset);
+        zpp::bits::vuint32_t delta, typeParams;
+        if (zpp::bits::failure(in(delta, typeParams)))
+            return false;
+        std::uint32_t params = typeParams % (PARAMS + 1);
+        e = {};
+        e.frame = delta;
+        e.type = typeParams / (PARAMS + 1);
+        for (std::uint32_t i = 0; i < params; ++i) {
+            zpp::bits::vsint32_t param;
+            if (zpp::bits::failure(in(param)))
+                return false;
+            e.params[i] = param;
+        }
+        offset = in.position();
+        return true;
+    }
+
+    // Places an event older than the last one after the other events of its frame. Only the
+    // following event's frame delta changes, so it is re-encoded and the two are spliced in.
+    void insert(const AutomationEvent& e) {
+        std::size_t at = 0, offset = 0;
+        unsigned frame = 0;
+        AutomationEvent next;
+        do {
+            at = offset;
+            if (!decode(offset, next))
+                return;
+            frame += next.frame;
+        } while (frame <= e.frame);
+        std::vector<std::byte> spliced;
+        encode(spliced, e.frame - (frame - next.frame), e);
+        encode(spliced, frame - e.frame, next);
+        bytes.erase(bytes.begin() + at, bytes.begin() + offset);
+        bytes.insert(bytes.begin() + at, spliced.begin(), spliced.end());
+        count++;
+    }
+
+    std::vector<AutomationEvent> unpack() const {
+        std::vector<AutomationEvent> events;
+        events.reserve(count);
+        std::size_t offset = 0;
+        unsigned frame = 0;
+        AutomationEvent e;
+        for (std::uint32_t i = 0; i < count && decode(offset, e); ++i) {
+            frame += e.frame;
+            e.frame = frame;
+            events.push_back(e);
+        }
+        return events;
+    }
+
+private:
+    // Appends `e` to `to` with `delta` as its frame delta.
+    static void encode(std::vector<std::byte>& to, std::uint32_t delta, const AutomationEvent& e) {
+        std::uint32_t params = PARAMS;
+        while (params && !e.params[params - 1])
+            params--;
+        zpp::bits::out out(to);
+        out.reset(to.size());
+        (void)out(zpp::bits::vuint32_t(delta), zpp::bits::vuint32_t(e.type * (PARAMS + 1) + params));
+        for (std::uint32_t i = 0; i < params; ++i)
+            (void)out(zpp::bits::vsint32_t(e.params[i]));
+        to.resize(out.position());
+    }
+};
+
+struct GameCaseInputChange {
+    std::uint32_t frame;
+    InputFrame input;
+};
+
+// Host input snapshots of a case: the input of the frame before recording started, the input
+// of every frame where it changed and the frame time of every frame.
+struct GameCaseInputs {
+    InputFrame initial = {};
+    std::vector<GameCaseInputChange> changes;
+    std::vector<float> frameTimes;
+
+    bool empty() const {
+        return frameTimes.empty();
+    }
+
+    // Frames have to be recorded in order, starting at 0.
+    void record(unsigned frame, const GameInput& input) {
+        if (frame == 0) {
+            initial = input.prev;
+            changes.clear();
+            frameTimes.clear();
+        }
+        if (!(input.now == (changes.empty() ? initial : changes.back().input)))
+            changes.push_back({frame, input.now});
+        frameTimes.push_back(input.frameTime);
+    }
+
+    const InputFrame& at(unsigned frame) const {
+        auto it = std::upper_bound(changes.begin(), changes.end(), frame, [](unsigned f, const GameCaseInputChange& c) { return f < c.frame; });
+        return it == changes.begin() ? initial : std::prev(it)->input;
+    }
+
+    void get(unsigned frame, GameInput& input) const {
+        input.now = at(frame);
+        input.prev = frame ? at(frame - 1) : initial;
+        input.frameTime = frame < frameTimes.size() ? frameTimes[frame] : 0.0f;
+    }
+};
+
+// Serialized GameState at the start of `frame` of a case, taken while recording.
+struct GameCaseKeyframe {
+    unsigned frame = 0;
+    std::vector<std::byte> state;
+};
+
+struct GameCase {
+    GameState gs = GameState();
+    PackedEvents events;
+    std::vector<GameCaseKeyframe> keyframes;
+    GameCaseInputs input;
+    // Hash of the state at the start of every hashInterval-th frame, taken while recording.
+    std::vector<std::uint64_t> hashes;
+    unsigned hashInterval = 0;
+};
+
+struct GameCasesState {
+    std::vector<GameCase> gameCases;
+    bool recording = false;
+    int replaying = false;
+    int casen = -1;
+    int frame = 0;
+    int aelframe = 0;
+};
+
+// Number of frames a case runs for: the whole recording, or through the frame of the last
+// event for recordings without input snapshots.
+inline unsigned gameCaseFrames(const GameCase& gc) {
+    return std::max<unsigned>(gc.events.frames(), unsigned(gc.input.frameTimes.size()));
+}
+
+// Frame -> events lookup of one case, built when the case starts replaying. The events of
+// frame f are the packed bytes from first[f] up to first[f + 1], so dispatching a frame
+// decodes only its own events and seeking to a frame is one lookup.
+struct GameCaseIndex {
+    PackedEvents events;
+    std::vector<std::uint32_t> first = {0};
+    unsigned length = 0;
+
+    void build(const GameCase& gc) {
+        events = gc.events;
+        first.assign(std::size_t(events.frames()) + 1, 0);
+        std::size_t offset = 0;
+        unsigned frame = 0, next = 0;
+        AutomationEvent e;
+        for (std::uint32_t i = 0; i < events.count; ++i) {
+            std::size_t at = offset;
+            if (!events.decode(offset, e))
+                break;
+            frame += e.frame;
+            while (next <= frame && next < first.size())
+                first[next++] = std::uint32_t(at);
+        }
+        while (next < first.size())
+            first[next++] = std::uint32_t(offset);
+        length = gameCaseFrames(gc);
+    }
+
+    // gameCaseFrames() of the indexed case.
+    unsigned frames() const {
+        return length;
+    }
+
+    template <typename Fn>
+    void forEachAt(unsigned frame, Fn&& fn) const {
+        if (std::size_t(frame) + 1 >= first.size())
+            return;
+        AutomationEvent e;
+        for (std::size_t offset = first[frame]; offset < first[frame + 1];) {
+            if (!events.decode(offset, e))
+                return;
+            e.frame = frame;
+            fn(e);
+        }
+    }
+
+    // Byte offset of the first event at or after `frame`.
+    std::uint32_t offset(unsigned frame) const {
+        return first[std::min<std::size_t>(frame, first.size() - 1)];
+    }
+};
+
+inline std::uint64_t hashGameState(const GameState& gs, std::vector<std::byte>& buffer) {
+    zpp::bits::out out(buffer);
+    if (zpp::bits::failure(out(gs)))
+        return 0;
+    return StateHash::hash(std::span<const std::byte>(buffer).first(out.position()));
+}
+
+// The recorded hash of the start of `frame`, if one was taken.
+inline bool recordedHash(const GameCase& gc, unsigned frame, std::uint64_t& hash) {
+    if (!gc.hashInterval || frame % gc.hashInterval || frame / gc.hashInterval >= gc.hashes.size())
+        return false;
+    hash = gc.hashes[frame / gc.hashInterval];
+    return true;
+}
+
+// Feeds frame `f` of a case to the game: the recorded host input when the case has it and the
+// library takes it, which needs nothing from raylib, otherwise the recorded raylib events
+// through raylib's input queue (snapshotted for libraries that take host input).
+inline void playGameCaseFrame(const GameApi& api, const GameCase& gc, const GameCaseIndex& index, unsigned f, GameInput& input) {
+    if (api.setInput && !gc.input.empty()) {
+        gc.input.get(f, input);
+        api.setInput(input);
+        return;
+    }
+    PollInputEvents();
+    index.forEachAt(f, PlayAutomationEvent);
+    if (api.setInput) {
+        // One frame of a case is one step, so the last capture has been consumed.
+        stepGameInput(input);
+        captureGameInput(input);
+        api.setInput(input);
+    }
+}
+
+inline bool captureKeyframe(GameCase& gc, unsigned frame, const GameState& gs) {
+    GameCaseKeyframe kf;
+    kf.frame = frame;
+    zpp::bits::out out(kf.state);
+    if (zpp::bits::failure(out(gs)))
+        return false;
+    kf.state.resize(out.position());
+    gc.keyframes.push_back(std::move(kf));
+    return true;
+}
+
+// Restores the nearest keyframe at or before `frame` (or the case's initial state) into `gs`
+// and returns the frame it is the start of.
+inline unsigned restoreGameCaseKeyframe(const GameApi& api, GameState& gs, const GameCase& gc, unsigned frame) {
+    auto kf = std::upper_bound(gc.keyframes.begin(), gc.keyframes.end(), frame, [](unsigned f, const GameCaseKeyframe& k) { return f < k.frame; });
+    unsigned from = 0;
+    const GameState* start = &gc.gs;
+    GameState ks;
+    if (kf != gc.keyframes.begin()) {
+        --kf;
+        zpp::bits::in in(kf->state);
+        if (zpp::bits::success(in(ks))) {
+            from = kf->frame;
+            start = &ks;
+        }
+    }
+    api.setState(gs, *start);
+    return from;
+}
+
+// Simulates frames [from, to) of a case on `gs`, which holds the state of the start of `from`.
+inline void playGameCaseFrames(const GameApi& api, GameState& gs, const GameCase& gc, const GameCaseIndex& index, unsigned from, unsigned to) {
+    ResetInputState();
+    auto step = api.update ? api.update : api.updateAndDraw;
+    GameInput input;
+    for (unsigned f = from; f < to; ++f) {
+        playGameCaseFrame(api, gc, index, f, input);
+        step(gs);
+    }
+}
+
+// Puts `gs` into the state of the start of `frame` of a case: restores the nearest keyframe
+// at or before it and replays the frames in between, so a seek costs at most one keyframe
+// interval of simulation. Returns the frame reached.
+inline unsigned seekGameCase(const GameApi& api, GameState& gs, const GameCase& gc, const GameCaseIndex& index, unsigned frame) {
+    frame = std::min(frame, index.frames());
+    playGameCaseFrames(api, gs, gc, index, restoreGameCaseKeyframe(api, gs, gc, frame), frame);
+    return frame;
+}
+
+// First frame at which replaying `gc` with the current game library no longer reproduces the
+// recorded hashes. Every keyframe is recorded truth, so the span from one keyframe up to and
+// including the next can be checked on its own: the first span whose last hashed frame
+// mismatches is found by replaying each span once, and inside it the first mismatching frame
+// is found by binary search, each probe replaying from the span's first keyframe. Probes never
+// seek to the next keyframe, which would restore it instead of simulating the step into it.
+// `matched` is the last frame that still agrees. Returns false when every span agrees.
+inline bool findDivergence(const GameApi& api, GameState& gs, const GameCase& gc, const GameCaseIndex& index, std::vector<std::byte>& buffer, unsigned& matched, unsigned& diverged) {
+    unsigned spanStart = 0;
+    auto mismatch = [&](unsigned frame) {
+        std::uint64_t expected;
+        if (!recordedHash(gc, frame, expected))
+            return false;
+        playGameCaseFrames(api, gs, gc, index, restoreGameCaseKeyframe(api, gs, gc, spanStart), frame);
+        return hashGameState(gs, buffer) != expected;
+    };
+    std::vector<unsigned> starts = {0};
+    for (auto& kf : gc.keyframes)
+        if (kf.frame > starts.back() && kf.frame <= index.frames())
+            starts.push_back(kf.frame);
+    for (std::size_t s = 0; s < starts.size(); ++s) {
+        unsigned end = s + 1 < starts.size() ? starts[s + 1] : index.frames();
+        spanStart = starts[s];
+        std::vector<unsigned> hashed;
+        std::uint64_t unused;
+        for (unsigned f = starts[s] + 1; f <= end; ++f)
+            if (recordedHash(gc, f, unused))
+                hashed.push_back(f);
+        if (hashed.empty() || !mismatch(hashed.back()))
+            continue;
+        std::size_t lo = 0, hi = hashed.size() - 1;
+        while (lo < hi) {
+            std::size_t mid = (lo + hi) / 2;
+            if (mismatch(hashed[mid]))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        diverged = hashed[lo];
+        matched = lo ? hashed[lo - 1] : starts[s];
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "raylib.h"
+
+#include "util/zpp_bits.h"
+
+// Input of one frame as the host saw it after polling: held keys, mouse and gamepads. It is
+// plain data without padding, so two frames compare with memcmp and recordings can store only
+// the frames where it changed.
+struct InputFrame {
+    static constexpr int KEYS = 512;
+    static constexpr int GAMEPADS = 4;
+    static constexpr int GAMEPAD_BUTTONS = 32;
+    static constexpr int GAMEPAD_AXES = 6;
+    static constexpr int MOUSE_BUTTONS = 7;
+    using serialize = zpp::bits::members<9>;
+
+    std::uint64_t keys[KEYS / 64];
+    float mouseX, mouseY;
+    float wheelX, wheelY;
+    std::uint32_t mouseButtons;
+    std::uint32_t gamepads;
+    std::uint32_t gamepadButtons[GAMEPADS];
+    float gamepadAxes[GAMEPADS][GAMEPAD_AXES];
+
+    bool key(int k) const {
+        return k >= 0 && k < KEYS && (keys[k / 64] >> (k % 64)) & 1;
+    }
+
+    bool operator==(const InputFrame& o) const {
+        return !std::memcmp(this, &o, sizeof(InputFrame));
+    }
+};
+static_assert(sizeof(InputFrame) == 200);
+
+// What the host hands to the game every frame through GameApi::setInput: this frame's input,
+// the previous frame's (for pressed/released edges) and the frame time. While replaying, all
+// of it comes from the recording, so a game that reads its input from here instead of raylib
+// replays without a window or raylib's event queue.
+struct GameInput {
+    InputFrame now = {};
+    InputFrame prev = {};
+    float frameTime = 0;
+    bool pending = false;   // `now` was captured but no step has seen it yet
+
+    bool keyDown(int k) const { return now.key(k); }
+    bool keyPressed(int k) const { return now.key(k) && !prev.key(k); }
+    bool keyReleased(int k) const { return !now.key(k) && prev.key(k); }
+    bool mouseDown(int b) const { return (now.mouseButtons >> b) & 1; }
+    bool mousePressed(int b) const { return mouseDown(b) && !((prev.mouseButtons >> b) & 1); }
+    bool mouseReleased(int b) const { return !mouseDown(b) && ((prev.mouseButtons >> b) & 1); }
+    Vector2 mousePosition() const { return {now.mouseX, now.mouseY}; }
+    Vector2 mouseWheel() const { return {now.wheelX, now.wheelY}; }
+    bool gamepadAvailable(int g) const { return g >= 0 && g < InputFrame::GAMEPADS && (now.gamepads >> g) & 1; }
+    bool gamepadDown(int g, int b) const { return gamepadAvailable(g) && (now.gamepadButtons[g] >> b) & 1; }
+    bool gamepadPressed(int g, int b) const { return gamepadDown(g, b) && !((prev.gamepadButtons[g] >> b) & 1); }
+    float gamepadAxis(int g, int a) const { return gamepadAvailable(g) ? now.gamepadAxes[g][a] : 0.0f; }
+};
+
+// Reads the current raylib input state; call after PollInputEvents().
+inline void captureInputFrame(InputFrame& in) {
+    in = {};
+    for (int k = 0; k < InputFrame::KEYS; ++k)
+        if (IsKeyDown(k))
+            in.keys[k / 64] |= std::uint64_t(1) << (k % 64);
+    Vector2 mouse = GetMousePosition();
+    Vector2 wheel = GetMouseWheelMoveV();
+    in.mouseX = mouse.x;
+    in.mouseY = mouse.y;
+    in.wheelX = wheel.x;
+    in.wheelY = wheel.y;
+    for (int b = 0; b < InputFrame::MOUSE_BUTTONS; ++b)
+        if (IsMouseButtonDown(b))
+            in.mouseButtons |= 1u << b;
+    for (int g = 0; g < InputFrame::GAMEPADS; ++g) {
+        if (!IsGamepadAvailable(g))
+            continue;
+        in.gamepads |= 1u << g;
+        for (int b = 0; b < InputFrame::GAMEPAD_BUTTONS; ++b)
+            if (IsGamepadButtonDown(g, b))
+                in.gamepadButtons[g] |= 1u << b;
+        for (int a = 0; a < InputFrame::GAMEPAD_AXES; ++a)
+            in.gamepadAxes[g][a] = GetGamepadAxisMovement(g, a);
+    }
+}
+
+// Moves `input` on to the live input of a new frame. Render frames that run no step leave their
+// capture pending: buttons it pressed stay down and wheel motion adds up until a step sees
+// them, so a tap between two steps still reaches the game as a pressed edge.
+inline void captureGameInput(GameInput& input) {
+    InputFrame live;
+    captureInputFrame(live);
+    if (input.pending) {
+        for (int i = 0; i < InputFrame::KEYS / 64; ++i)
+            live.keys[i] |= input.now.keys[i] & ~input.prev.keys[i];
+        live.mouseButtons |= input.now.mouseButtons & ~input.prev.mouseButtons;
+        for (int g = 0; g < InputFrame::GAMEPADS; ++g)
+            live.gamepadButtons[g] |= input.now.gamepadButtons[g] & ~input.prev.gamepadButtons[g];
+        live.wheelX += input.now.wheelX;
+        live.wheelY += input.now.wheelY;
+    }
+    input.now = live;
+    input.pending = true;
+    input.frameTime = GetFrameTime();
+}
+
+// Call after every simulation step: the step has seen `now`, which becomes the previous input
+// the next step's edges are taken against.
+inline void stepGameInput(GameInput& input) {
+    input.prev = input.now;
+    input.pending = false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include "game_api.h"
+
+#define NOGDI
+#define NOUSER
+#include <dylib.hpp>
+
+const std::string LIB_NAME = "GAME";
+#if defined(_WIN32)
+const std::string LIB_PATH = "..\\game\\build\\";
+const std::string LIB_PREFIX = "";
+const std::string LIB_EXT = ".dll";
+#elif defined(__linux__)
+const std::string LIB_PATH = "../game/build/";
+const std::string LIB_PREFIX = "lib";
+const std::string LIB_EXT = ".so";
+#endif
+const std::string NEW_LIB_POSTFIX = "_NEW";
+const std::string GENERATION_FILE_EXT = ".generation";
+
+// One loaded generation of the game library together with its entry point table.
+struct GameLib {
+    dylib lib;
+    std::filesystem::path stagedPath;
+    GameApi api = {};
+
+    GameLib(dylib&& loaded, const std::filesystem::path& stagedPath = {}) :
+        lib(std::move(loaded)),
+        stagedPath(stagedPath)
+    {
+        if (!lib.has_symbol("getGameApi")) {
+            // Libraries built before getGameApi() existed only export the loose symbols.
+            api.init = lib.get_function<void(GameAssets&, GameState&)>("init");
+            api.reset = lib.get_function<void(GameState&)>("reset");
+            api.setState = lib.get_function<void(GameState&, const GameState&)>("setState");
+            api.updateAndDraw = lib.get_function<void(GameState&)>("updateAndDraw");
+            if (lib.has_symbol("update"))
+                api.update = lib.get_function<void(GameState&)>("update");
+            if (lib.has_symbol("setInput"))
+                api.setInput = lib.get_function<void(const GameInput&)>("setInput");
+            if (lib.has_symbol("draw"))
+                api.draw = lib.get_function<void(const GameState&, float)>("draw");
+            api.version = GAME_API_VERSION;
+            api.size = sizeof(GameApi);
+            return;
+        }
+        const GameApi* exported = lib.get_function<GetGameApiFn>("getGameApi")();
+        if (!exported || exported->version != GAME_API_VERSION || exported->size < GAME_API_REQUIRED_SIZE)
+            throw std::runtime_error("game API version mismatch: host " + std::to_string(GAME_API_VERSION) +
+                ", library " + (exported ? std::to_string(exported->version) : std::string("none")));
+        // Optional members the library predates stay null.
+        std::memcpy(&api, exported, std::min<std::size_t>(exported->size, sizeof(GameApi)));
+        api.size = sizeof(GameApi);
+        if (!api.init || !api.reset || !api.setState || !api.updateAndDraw)
+            throw std::runtime_error("game API table is incomplete");
+    }
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game_cases.h"
+
+// Records the events of one case without relying on raylib's fixed-capacity event list: the
+// host drains the list every step, so it never holds more than a frame of events, and the
+// events are packed into fixed-size chunks that are never reallocated. With a stream path,
+// every full chunk is appended to that file and dropped, so memory stays bounded however long
+// the recording runs; if writing it fails, recording carries on in memory from that chunk on.
+// Chunks continue one delta-coded PackedEvents stream, so finishing is a concatenation, done
+// off the render thread.
+struct GameCaseRecorder {
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    PackedEvents tail;
+    std::vector<std::vector<std::byte>> chunks;
+    std::filesystem::path streamPath;
+    std::ofstream stream;
+    std::size_t streamed = 0;
+
+    // take() the previous recording first; one still being assembled is waited for and dropped.
+    void start(const std::filesystem::path& toStream = {}) {
+        pending = {};
+        tail.clear();
+        tail.bytes.reserve(CHUNK_SIZE + 64);
+        chunks.clear();
+        streamPath = toStream;
+        stream = {};
+        streamed = 0;
+        if (!streamPath.empty()) {
+            stream.open(streamPath, std::ios::binary | std::ios::trunc);
+            if (!stream)
+                std::cerr << "Failed to open " << streamPath << ", recording in memory" << std::endl;
+        }
+    }
+
+    // Appends every event of `list` as an event of `frame` and empties the list. Frames are
+    // the host's simulation steps, not raylib's render frame counter, so a replay applies each
+    // event at the step that first saw it whatever the render rate was.
+    void drain(AutomationEventList& list, unsigned frame) {
+        for (unsigned i = 0; i < list.count; ++i) {
+            auto e = list.events[i];
+            e.frame = frame;
+            tail.append(e);
+        }
+        list.count = 0;
+        if (tail.bytes.size() >= CHUNK_SIZE)
+            flush();
+    }
+
+    // Ends the recording. Everything recorded is assembled into one PackedEvents on a background
+    // thread, so stopping costs the render thread no reading or copying however long the stream
+    // is; take() collects the result.
+    void finish() {
+        if (stream.is_open())
+            stream.close();
+        pending = std::async(std::launch::async, assemble, std::exchange(chunks, {}), std::exchange(tail, {}), streamPath, streamed);
+    }
+
+    // A finished recording is still being assembled or has not been taken yet.
+    bool finishing() const {
+        return pending.valid();
+    }
+
+    // Moves the events of the finished recording into `events` once they are assembled,
+    // blocking until then with `wait`. Returns false while they are not ready, or if nothing
+    // was finished.
+    bool take(PackedEvents& events, bool wait = false) {
+        if (!pending.valid() || (!wait && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+            return false;
+        events = pending.get();
+        return true;
+    }
+
+private:
+    std::future<PackedEvents> pending;
+
+    // Concatenates the streamed bytes, the chunks kept in memory and the tail. If the stream
+    // cannot be read back, the case gets no events and the stream file is left for inspection.
+    static PackedEvents assemble(std::vector<std::vector<std::byte>> chunks, PackedEvents tail, std::filesystem::path streamPath, std::size_t streamed) {
+        PackedEvents events;
+        std::size_t size = streamed + tail.bytes.size();
+        for (auto& chunk : chunks)
+            size += chunk.size();
+        events.bytes.reserve(size);
+        if (streamed) {
+            std::ifstream in(streamPath, std::ios::binary);
+            events.bytes.resize(streamed);
+            if (!in.read((char*)events.bytes.data(), std::streamsize(streamed))) {
+                std::cerr << "Failed to read back " << streamPath << std::endl;
+                return {};
+            }
+        }
+        if (!streamPath.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(streamPath, ec);
+        }
+        for (auto& chunk : chunks)
+            events.bytes.insert(events.bytes.end(), chunk.begin(), chunk.end());
+        events.bytes.insert(events.bytes.end(), tail.bytes.begin(), tail.bytes.end());
+        events.count = tail.count;
+        events.lastFrame = tail.lastFrame;
+        return events;
+    }
+
+    void flush() {
+        if (stream.is_open()) {
+            stream.write((const char*)tail.bytes.data(), std::streamsize(tail.bytes.size()));
+            if (stream.flush()) {
+                streamed += tail.bytes.size();
+                tail.bytes.clear();
+                return;
+            }
+            // Only the bytes written before are trusted; this chunk stays in memory.
+            std::cerr << "Failed to write " << streamPath << ", recording the rest in memory" << std::endl;
+            stream.close();
+        }
+        chunks.push_back(std::exchange(tail.bytes, {}));
+        tail.bytes.reserve(CHUNK_SIZE + 64);
+    }
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstddef>
 #include <math.h>
 #include <string>
@@ -6,11 +7,29 @@
 #include "raylib.h"
 
 #include "../game/src/game.h"
+#include "game_input.h"
+#include "util/frame_profiler.h"
 
 const int TARGET_FPS = 60;
+const int SIM_HZ = 120;
+const float SIM_DT = 1.0f / SIM_HZ;
+const float MAX_FRAME_TIME = 0.25f;
+const int PROFILE_FRAMES = 1024;
+const int PROFILE_STATS_FRAMES = TARGET_FPS * 4;
+const int PROFILE_OVERLAY_REFRESH = TARGET_FPS / 2;
+const std::string PROFILE_TRACE_NAME = "frames";
 
 struct BaseState {
     Vector2 winSz, baseWinSz;
+    GameInput input;
+    FrameProfiler profiler = FrameProfiler(PROFILE_FRAMES);
+    bool profileOverlay = false;
+
+    // The game draws the whole frame itself, so the summary goes to the window title.
+    void showProfile() {
+        if (profileOverlay && profiler.frames % PROFILE_OVERLAY_REFRESH == 0)
+            SetWindowTitle((WIN_NOM + profiler.summary(PROFILE_STATS_FRAMES)).c_str());
+    }
 };
 
 void initWindow() {
@@ -26,6 +45,7 @@ void initWindow() {
 void processInput(BaseState& bs, GameAssets& ga, GameState& gs) 
 {
     PollInputEvents();
+    captureGameInput(bs.input);
 
     if (IsKeyPressed(KEY_F) || IsKeyPressed(KEY_F11) || (IsKeyPressed(KEY_ENTER) && (IsKeyDown(KEY_LEFT_ALT) || IsKeyDown(KEY_RIGHT_ALT)))) {
         if (!IsWindowFullscreen()) {
@@ -47,6 +67,15 @@ void processInput(BaseState& bs, GameAssets& ga, GameState& gs)
             SetWindowSize(int(bs.winSz.x), int(bs.winSz.y));
         }
     }
+
+    // F9 shows p50/p99/max milliseconds per phase, F10 writes the recent frames as CSV and trace.
+    if (IsKeyPressed(KEY_F9)) {
+        bs.profileOverlay = !bs.profileOverlay;
+        if (!bs.profileOverlay)
+            SetWindowTitle(WIN_NOM);
+    }
+    if (IsKeyPressed(KEY_F10))
+        bs.profiler.dump(PROFILE_TRACE_NAME);
 }
 
 int main() 
@@ -59,9 +88,47 @@ int main()
 
     init(ga, gs);
 
+#if defined(GAME_FIXED_TIMESTEP)
+    float accumulator = 0;
+#endif
     while (!WindowShouldClose()) {
-        processInput(bs, ga, gs);
-        updateAndDraw(gs);
+        bs.profiler.beginFrame();
+        {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_INPUT);
+            processInput(bs, ga, gs);
+        }
+#if defined(GAME_FIXED_TIMESTEP)
+        // Games with separate update() and draw() define GAME_FIXED_TIMESTEP in game.h and are
+        // simulated in SIM_DT steps, like the shared host does through GameApi.
+        accumulator += std::min(GetFrameTime(), MAX_FRAME_TIME);
+        bs.input.frameTime = SIM_DT;
+        while (accumulator >= SIM_DT) {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_UPDATE);
+#if defined(GAME_INPUT_SNAPSHOT)
+            setInput(bs.input);
+#endif
+            update(gs);
+            stepGameInput(bs.input);
+            accumulator -= SIM_DT;
+        }
+        {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_DRAW);
+            draw(gs, accumulator / SIM_DT);
+        }
+#else
+        {
+            auto timed = bs.profiler.scope(FrameProfiler::PHASE_UPDATE);
+#if defined(GAME_INPUT_SNAPSHOT)
+            // Games that read their input from the host snapshot define GAME_INPUT_SNAPSHOT and
+            // setInput() in game.h, the same entry the shared host calls through GameApi.
+            setInput(bs.input);
+#endif
+            updateAndDraw(gs);
+            stepGameInput(bs.input);
+        }
+#endif
+        bs.profiler.endFrame();
+        bs.showProfile();
         if (IsKeyPressed(KEY_R))
             reset(gs);
     }
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raylib.h"
+
+#include "../game/src/game.h"
+#include "game_api.h"
+#include "game_lib.h"
+#include "game_cases.h"
+#include "util/zpp_bits.h"
+#include "util/save_container.h"
+#include "util/save_reader.h"
+
+#include "resources.h"
+
+// Headless replay: plays the recorded game cases of a save back as fast as the game can
+// simulate, without presenting frames, and reports throughput and a hash of every final
+// state so two builds (or two runs) can be compared for determinism.
+//
+//   GAME_REPLAY [--container saves] [--save state] [--case n] [--lib ../game/build/]
+//               [--jobs n] [--from frame] [--record hashes.txt] [--check hashes.txt] [--bisect]
+//               [--no-window]
+//
+// Cases are independent, so with --jobs they are split across worker processes (raylib's
+// input state is global, which rules out threads) and the results are gathered here.
+// --record writes the final hash of every case, --check fails every case whose hash differs.
+// --from starts every case at a later frame through its nearest recorded keyframe.
+// --bisect compares every case against the state hashes taken while it was recorded, finds
+// the first frame that differs and writes the last agreeing and the first differing state
+// next to the save as <save>.case<n>.frame<f>.state.
+//
+// Cases recorded with host input snapshots are fed to a library that exports setInput()
+// directly; anything else goes through raylib's input queue, which needs a (hidden) window,
+// as do games that draw inside updateAndDraw() or load assets in init(). When the library
+// exports update() and setInput() and init() does not touch the GPU, --no-window skips the
+// window entirely; otherwise run under a virtual display (xvfb-run) on headless machines.
+
+#if defined(_WIN32)
+#define popen _popen
+#define pclose _pclose
+#endif
+
+const std::string SAVE_CONTAINER = "saves";
+const std::string DEFAULT_SAVE_SLOT = "state";
+
+struct ReplayOptions {
+    std::string container = SAVE_CONTAINER;
+    std::string save = DEFAULT_SAVE_SLOT;
+    std::string libPath = LIB_PATH;
+    std::string record, check;
+    std::vector<int> cases;
+    int jobs = int(std::max(1u, std::thread::hardware_concurrency()));
+    unsigned from = 0;
+    bool bisect = false;
+    bool worker = false;
+    bool window = true;
+};
+
+struct ReplayResult {
+    int casen = 0;
+    std::size_t frames = 0;
+    double seconds = 0;
+    std::uint64_t hash = 0;
+    long long matched = -1, diverged = -1;
+    bool done = false;
+};
+
+bool parseArgs(int argc, char** argv, ReplayOptions& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--worker" || arg == "--bisect") {
+            (arg == "--worker" ? opts.worker : opts.bisect) = true;
+            continue;
+        }
+        if (arg == "--no-window") {
+            opts.window = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--container")
+            opts.container = value;
+        else if (arg == "--save")
+            opts.save = value;
+        else if (arg == "--lib")
+            opts.libPath = value;
+        else if (arg == "--case")
+            opts.cases.push_back(std::stoi(value) - 1);
+        else if (arg == "--cases") {
+            std::stringstream list(value);
+            for (std::string n; std::getline(list, n, ',');)
+                opts.cases.push_back(std::stoi(n) - 1);
+        } else if (arg == "--jobs")
+            opts.jobs = std::max(1, std::stoi(value));
+        else if (arg == "--from")
+            opts.from = unsigned(std::stoul(value));
+        else if (arg == "--record")
+            opts.record = value;
+        else if (arg == "--check")
+            opts.check = value;
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The newest build: the published generation in versioned mode, else GAME, else GAME_NEW.
+std::filesystem::path findGameLib(const std::filesystem::path& dir) {
+    int generation = 0;
+    std::ifstream(dir / (LIB_NAME + GENERATION_FILE_EXT)) >> generation;
+    auto versioned = dir / (LIB_PREFIX + LIB_NAME + "." + std::to_string(generation) + LIB_EXT);
+    if (generation > 0 && std::filesystem::exists(versioned))
+        return versioned;
+    auto lib = dir / (LIB_PREFIX + LIB_NAME + LIB_EXT);
+    return std::filesystem::exists(lib) ? lib : dir / (LIB_PREFIX + LIB_NAME + NEW_LIB_POSTFIX + LIB_EXT);
+}
+
+// Runs one case from frame `from` (reached through the nearest keyframe) to its end, with the
+// same per-frame order as the interactive host: feed this frame's input, step the game.
+ReplayResult replayCase(const GameApi& api, GameState& gs, const GameCase& gc, int casen, std::vector<std::byte>& buffer, unsigned from = 0) {
+    ReplayResult result;
+    result.casen = casen;
+    GameCaseIndex index;
+    index.build(gc);
+    unsigned frames = index.frames();
+    unsigned frame = seekGameCase(api, gs, gc, index, from);
+    auto step = api.update ? api.update : api.updateAndDraw;
+    GameInput input;
+    auto start = std::chrono::steady_clock::now();
+    for (; frame < frames; ++frame) {
+        playGameCaseFrame(api, gc, index, frame, input);
+        step(gs);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.frames = frames - std::min(from, frames);
+    result.hash = hashGameState(gs, buffer);
+    return result;
+}
+
+// Splits the cases into `jobs` groups of about equal total length, longest cases first.
+std::vector<std::vector<int>> shardCases(const GameCasesState& gcs, const std::vector<int>& cases, int jobs) {
+    auto order = cases;
+    auto length = [&](int i) { return gameCaseFrames(gcs.gameCases[i]); };
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return length(a) > length(b); });
+    std::vector<std::vector<int>> shards(std::min<std::size_t>(jobs, order.size()));
+    std::vector<std::size_t> load(shards.size());
+    for (int i : order) {
+        auto s = std::size_t(std::min_element(load.begin(), load.end()) - load.begin());
+        shards[s].push_back(i);
+        load[s] += length(i);
+    }
+    return shards;
+}
+
+std::string quoteArg(const std::string& arg) {
+    return "\"" + arg + "\"";
+}
+
+// Starts one worker process per shard and collects the "result" lines they print.
+bool runWorkers(const char* self, const ReplayOptions& opts, const std::vector<std::vector<int>>& shards, std::vector<ReplayResult>& results) {
+    std::vector<FILE*> pipes;
+    for (auto& shard : shards) {
+        std::string list;
+        for (int i : shard)
+            list += (list.empty() ? "" : ",") + std::to_string(i + 1);
+        auto cmd = quoteArg(self) + " --worker --container " + quoteArg(opts.container) + " --save " + quoteArg(opts.save) +
+            " --lib " + quoteArg(opts.libPath) + " --from " + std::to_string(opts.from) + " --cases " + list + (opts.bisect ? " --bisect" : "") +
+            (opts.window ? "" : " --no-window");
+        if (FILE* pipe = popen(cmd.c_str(), "r"))
+            pipes.push_back(pipe);
+        else
+            std::cerr << "Failed to start worker " << cmd << std::endl;
+    }
+    bool ok = pipes.size() == shards.size();
+    for (auto pipe : pipes) {
+        char line[256];
+        while (std::fgets(line, sizeof(line), pipe)) {
+            std::istringstream in(line);
+            std::string tag;
+            ReplayResult r;
+            if (!(in >> tag >> r.casen >> r.frames >> r.seconds >> std::hex >> r.hash >> std::dec >> r.matched >> r.diverged) || tag != "result" || r.casen < 0 || r.casen >= int(results.size()))
+                continue;
+            r.done = true;
+            results[r.casen] = r;
+        }
+        ok = pclose(pipe) == 0 && ok;
+    }
+    return ok;
+}
+
+std::map<int, std::uint64_t> readHashes(const std::string& path) {
+    std::map<int, std::uint64_t> hashes;
+    std::ifstream in(path);
+    int casen;
+    std::uint64_t hash;
+    while (in >> std::dec >> casen >> std::hex >> hash)
+        hashes[casen - 1] = hash;
+    return hashes;
+}
+
+bool dumpState(const GameState& gs, const std::string& path) {
+    std::vector<std::byte> bytes;
+    zpp::bits::out out(bytes);
+    std::ofstream file(path, std::ios::binary);
+    return zpp::bits::success(out(gs)) && file.write((const char*)bytes.data(), std::streamsize(out.position()));
+}
+
+ReplayResult bisectCase(const GameApi& api, GameState& gs, const GameCase& gc, int casen, std::vector<std::byte>& buffer, const std::string& prefix) {
+    ReplayResult result;
+    result.casen = casen;
+    GameCaseIndex index;
+    index.build(gc);
+    result.frames = index.frames();
+    auto start = std::chrono::steady_clock::now();
+    unsigned matched, diverged;
+    if (findDivergence(api, gs, gc, index, buffer, matched, diverged)) {
+        result.matched = matched;
+        result.diverged = diverged;
+        for (unsigned frame : {matched, diverged}) {
+            auto path = prefix + ".case" + std::to_string(casen + 1) + ".frame" + std::to_string(frame) + ".state";
+            // Simulated into, not restored, even where a keyframe was recorded.
+            playGameCaseFrames(api, gs, gc, index, restoreGameCaseKeyframe(api, gs, gc, frame ? frame - 1 : 0), frame);
+            if (!dumpState(gs, path))
+                std::cerr << "Failed to write " << path << std::endl;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void initWindow() {
+    SetTraceLogLevel(LOG_ERROR);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WIN_NOM);
+    SetTargetFPS(0);
+}
+
+int main(int argc, char** argv)
+{
+    ReplayOptions opts;
+    if (!parseArgs(argc, argv, opts))
+        return 2;
+
+    auto libFile = findGameLib(std::filesystem::current_path() / opts.libPath);
+    std::unique_ptr<GameLib> game;
+    try {
+        game = std::make_unique<GameLib>(dylib(libFile));
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to load " << libFile << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    SaveContainer saves(opts.container);
+    if (!saves.open())
+        std::cerr << "Failed to open save container " << opts.container << std::endl;
+    std::vector<std::byte> buffer;
+    GameState saved;
+    GameCasesState gcs;
+    if (!readSave(saves, opts.save, buffer, saved, gcs))
+        return 1;
+    auto cases = opts.cases;
+    if (cases.empty())
+        for (int i = 0; i < int(gcs.gameCases.size()); ++i)
+            cases.push_back(i);
+    for (int i : cases) {
+        if (i < 0 || i >= int(gcs.gameCases.size())) {
+            std::cerr << "No case " << i + 1 << " in " << opts.save << std::endl;
+            return 1;
+        }
+    }
+
+    if (!opts.window) {
+        bool headless = game->api.update && game->api.setInput;
+        for (int i : cases)
+            headless = headless && !gcs.gameCases[i].input.empty();
+        if (!headless) {
+            std::cerr << "--no-window needs a library exporting update() and setInput() and cases recorded with input snapshots" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<ReplayResult> results(gcs.gameCases.size());
+    auto start = std::chrono::steady_clock::now();
+    if (opts.jobs > 1 && cases.size() > 1 && !opts.worker) {
+        game.reset();
+        if (!runWorkers(argv[0], opts, shardCases(gcs, cases, opts.jobs), results))
+            std::cerr << "Some replay workers failed" << std::endl;
+    } else {
+        if (opts.window)
+            initWindow();
+        GameAssets ga;
+        GameState gs;
+        game->api.init(ga, gs);
+        for (int i : cases) {
+            if (opts.bisect)
+                results[i] = bisectCase(game->api, gs, gcs.gameCases[i], i, buffer, opts.save);
+            else
+                results[i] = replayCase(game->api, gs, gcs.gameCases[i], i, buffer, opts.from);
+            results[i].done = true;
+            if (opts.worker) {
+                auto& r = results[i];
+                std::cout << "result " << r.casen << " " << r.frames << " " << r.seconds << " " << std::hex << r.hash << std::dec
+                    << " " << r.matched << " " << r.diverged << std::endl;
+            }
+        }
+        if (opts.window)
+            CloseWindow();
+        game.reset();
+    }
+    if (opts.worker)
+        return 0;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto expected = opts.check.empty() ? std::map<int, std::uint64_t>() : readHashes(opts.check);
+    std::size_t totalFrames = 0, failed = 0;
+    double totalSeconds = 0;
+    for (int i : cases) {
+        auto& r = results[i];
+        auto it = expected.find(i);
+        bool pass = r.done && r.diverged < 0 && (opts.check.empty() || opts.bisect || (it != expected.end() && it->second == r.hash));
+        failed += !pass;
+        totalFrames += r.frames;
+        totalSeconds += r.seconds;
+        std::cout << "case " << i + 1 << ": ";
+        if (!r.done) {
+            std::cout << "FAIL (no result)" << std::endl;
+            continue;
+        }
+        if (opts.bisect) {
+            std::cout << (pass ? "ok" : "FAIL") << ", " << r.frames << " frames checked in " << r.seconds << " s";
+            if (r.diverged >= 0)
+                std::cout << ", diverges at frame " << r.diverged << " (last match " << r.matched << ")";
+            std::cout << std::endl;
+            continue;
+        }
+        std::cout << (pass ? "ok" : "FAIL") << ", " << r.frames << " frames, " << (r.seconds > 0 ? r.frames / r.seconds : 0)
+            << " frames/s, hash " << std::hex << r.hash << std::dec << std::endl;
+    }
+    std::cout << "total: " << cases.size() - failed << "/" << cases.size() << " passed, " << totalFrames << " frames, "
+        << totalSeconds << " s replaying, " << wall << " s wall" << std::endl;
+
+    if (!opts.record.empty() && !opts.bisect) {
+        std::ofstream out(opts.record);
+        for (int i : cases)
+            if (results[i].done)
+                out << std::dec << i + 1 << " " << std::hex << results[i].hash << "\n";
+    }
+
+    return failed ? 1 : 0;
+}
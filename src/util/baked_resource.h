@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#include "raylib.h"
+
+// Layouts resbake (util/resbake.cpp) writes for images and sounds that embed_resources bakes
+// (BAKE_IMAGES, BAKE_SOUNDS): a 32-byte header followed by the data exactly as raylib holds it
+// in memory, so loading one is a pointer into the resource and an upload, with no decoding.
+// Headers are native endian; bakes are made for the machine that builds the game.
+struct BakedImageHeader {
+    static constexpr char MAGIC[4] = {'R', 'B', 'I', 'M'};
+    static constexpr std::uint32_t VERSION = 1;
+
+    char magic[4];
+    std::uint32_t version;
+    std::int32_t width, height, mipmaps, format;
+    std::uint64_t dataSize;
+};
+static_assert(sizeof(BakedImageHeader) == 32);
+
+struct BakedWaveHeader {
+    static constexpr char MAGIC[4] = {'R', 'B', 'W', 'V'};
+    static constexpr std::uint32_t VERSION = 1;
+
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t frameCount, sampleRate, sampleSize, channels;
+    std::uint64_t dataSize;
+};
+static_assert(sizeof(BakedWaveHeader) == 32);
+
+// Bytes of an image's pixels including every level of its mip chain.
+inline std::uint64_t bakedImageDataSize(int width, int height, int mipmaps, int format) {
+    std::uint64_t size = 0;
+    for (int level = 0; level < mipmaps; ++level) {
+        size += std::uint64_t(GetPixelDataSize(width, height, format));
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+template <typename Header>
+inline const Header* bakedHeader(std::span<const std::byte> bytes) {
+    if (bytes.size() < sizeof(Header))
+        return nullptr;
+    auto header = (const Header*)bytes.data();
+    if (std::memcmp(header->magic, Header::MAGIC, 4) || header->version != Header::VERSION)
+        return nullptr;
+    if (header->dataSize > bytes.size() - sizeof(Header))
+        return nullptr;
+    return header;
+}
+
+// An Image viewing the baked pixels in `bytes`; it does not own them, so never UnloadImage() it
+// (ImageCopy() it to get an owned one). Returns false when `bytes` is not a baked image.
+inline bool viewBakedImage(std::span<const std::byte> bytes, Image& image) {
+    auto header = bakedHeader<BakedImageHeader>(bytes);
+    if (!header || header->dataSize < bakedImageDataSize(header->width, header->height, header->mipmaps, header->format))
+        return false;
+    image.data = (void*)(header + 1);
+    image.width = header->width;
+    image.height = header->height;
+    image.mipmaps = header->mipmaps;
+    image.format = header->format;
+    return true;
+}
+
+// A Wave viewing the baked samples in `bytes`, with the same ownership rule as viewBakedImage().
+inline bool viewBakedWave(std::span<const std::byte> bytes, Wave& wave) {
+    auto header = bakedHeader<BakedWaveHeader>(bytes);
+    if (!header || header->dataSize < std::uint64_t(header->frameCount) * header->channels * (header->sampleSize / 8))
+        return false;
+    wave.data = (void*)(header + 1);
+    wave.frameCount = header->frameCount;
+    wave.sampleRate = header->sampleRate;
+    wave.sampleSize = header->sampleSize;
+    wave.channels = header->channels;
+    return true;
+}
@@ -1,5 +1,18 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "lz_fast.h"
+
+// Output styles, fastest first. INCBIN and EMBED leave the bytes to the assembler/compiler, so
+// the generated source stays a few lines however large the resource is; HEX spells every byte
+// out and works with any C compiler. All of them define the same two symbols:
+//   const char {sym}[]      the contents followed by a terminating 0
+//   const size_t {sym}_len  the size of {sym}, i.e. the file size + 1
+// With -z the contents are lz_fast compressed when that makes them smaller, and
+//   const unsigned long long {sym}_size  the uncompressed file size + 1
+// is defined as well; {sym} holds the compressed block exactly when {sym}_len < {sym}_size.
+enum { MODE_INCBIN, MODE_EMBED, MODE_HEX };
 
 FILE* open_or_exit(const char* fname, const char* mode)
 {
@@ -11,44 +24,348 @@ FILE* open_or_exit(const char* fname, const char* mode)
   return f;
 }
 
-int main(int argc, char** argv)
+long size_or_exit(FILE* f, const char* fname)
 {
-  if (argc < 3) {
-    fprintf(stderr, "USAGE: %s {sym} {rsrc}\n\n"
-        "  Creates {sym}.c from the contents of {rsrc}\n",
-        argv[0]);
-    return EXIT_FAILURE;
+  long size = -1;
+  if (fseek(f, 0, SEEK_END) == 0)
+    size = ftell(f);
+  if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+    perror(fname);
+    exit(EXIT_FAILURE);
   }
+  return size;
+}
 
-  const char* sym = argv[1];
-  FILE* in = open_or_exit(argv[2], "rb");
+// Writes `path` as the inside of a string literal: forward slashes (which every assembler and
+// compiler accepts on Windows too) and escaped quotes. `quote` is the escape for a '"', which
+// differs when the literal is itself nested in a C string.
+void write_path(FILE* out, const char* path, const char* quote)
+{
+  for (const char* p = path; *p; ++p) {
+    if (*p == '\\') fputc('/', out);
+    else if (*p == '"') fputs(quote, out);
+    else fputc(*p, out);
+  }
+}
 
-  char symfile[256];
-  snprintf(symfile, sizeof(symfile), "%s.c", sym);
+void write_aligned(FILE* out, int align)
+{
+  fprintf(out,
+      "#if defined(_MSC_VER)\n"
+      "#define EMBED_ALIGNED __declspec(align(%d))\n"
+      "#else\n"
+      "#define EMBED_ALIGNED __attribute__((aligned(%d)))\n"
+      "#endif\n\n", align, align);
+}
 
-  FILE* out = open_or_exit(symfile,"w");
-  fprintf(out, "#include <stdlib.h>\n");
-  fprintf(out, "const char %s[] = {\n", sym);
+void write_incbin(FILE* out, const char* sym, const char* path, long size, int align)
+{
+  fprintf(out, "#include <stddef.h>\n\n");
+  fprintf(out, "const size_t %s_len = %ld;\n\n", sym, size + 1);
+  fprintf(out,
+      "#define EMBED_STR2(x) #x\n"
+      "#define EMBED_STR(x) EMBED_STR2(x)\n"
+      "#if defined(__APPLE__)\n"
+      "#define EMBED_SECTION \".const_data\\n\"\n"
+      "#define EMBED_SECTION_END \".text\\n\"\n"
+      "#elif defined(_WIN32)\n"
+      "#define EMBED_SECTION \".pushsection .rdata, \\\"dr\\\"\\n\"\n"
+      "#define EMBED_SECTION_END \".popsection\\n\"\n"
+      "#else\n"
+      "#define EMBED_SECTION \".pushsection .rodata, \\\"a\\\"\\n\"\n"
+      "#define EMBED_SECTION_END \".popsection\\n\"\n"
+      "#endif\n\n");
+  fprintf(out, "__asm__(\n");
+  fprintf(out, "  EMBED_SECTION\n");
+  fprintf(out, "  \".globl \" EMBED_STR(__USER_LABEL_PREFIX__) \"%s\\n\"\n", sym);
+  fprintf(out, "  \".balign %d\\n\"\n", align);
+  fprintf(out, "  EMBED_STR(__USER_LABEL_PREFIX__) \"%s:\\n\"\n", sym);
+  fprintf(out, "  \".incbin \\\"");
+  write_path(out, path, "\\\\\\\"");
+  fprintf(out, "\\\"\\n\"\n");
+  fprintf(out, "  \".byte 0\\n\"\n");
+  fprintf(out, "  EMBED_SECTION_END\n");
+  fprintf(out, ");\n");
+}
+
+void write_embed(FILE* out, const char* sym, const char* path, int align)
+{
+  fprintf(out, "#include <stddef.h>\n\n");
+  write_aligned(out, align);
+  fprintf(out, "EMBED_ALIGNED const char %s[] = {\n", sym);
+  fprintf(out, "#embed \"");
+  write_path(out, path, "\\\"");
+  fprintf(out, "\" suffix(,)\n");
+  fprintf(out, "0x00};\n");
+  fprintf(out, "const size_t %s_len = sizeof(%s);\n\n", sym, sym);
+}
 
-  unsigned char buf[256];
+void write_hex(FILE* out, const char* sym, FILE* in, int align)
+{
+  static const char digits[] = "0123456789abcdef";
+  fprintf(out, "#include <stdlib.h>\n\n");
+  write_aligned(out, align);
+  fprintf(out, "EMBED_ALIGNED const char %s[] = {\n", sym);
+
+  // One fwrite per input block instead of one fprintf per byte.
+  unsigned char buf[4096];
+  char line[sizeof(buf) * 6 + sizeof(buf) / 10 + 1];
   size_t nread = 0;
   size_t linecount = 0;
-  size_t c = 0;
-  do {
-    nread = fread(buf, 1, sizeof(buf), in);
-    size_t i;
-    for (i=0; i < nread; i++) {
-      fprintf(out, "0x%02x, ", buf[i]);
-      if (++linecount == 10) { fprintf(out, "\n"); linecount = 0; }
+  while ((nread = fread(buf, 1, sizeof(buf), in)) > 0) {
+    char* o = line;
+    for (size_t i = 0; i < nread; i++) {
+      *o++ = '0'; *o++ = 'x';
+      *o++ = digits[buf[i] >> 4]; *o++ = digits[buf[i] & 15];
+      *o++ = ','; *o++ = ' ';
+      if (++linecount == 10) { *o++ = '\n'; linecount = 0; }
     }
-    c++;
-  } while (nread > 0);
+    fwrite(line, 1, (size_t)(o - line), out);
+  }
   if (linecount > 0) fprintf(out, "\n");
   fprintf(out, "0x00};\n");
-  fprintf(out, "const size_t %s_len = sizeof(%s);\n\n",sym,sym);
+  fprintf(out, "const size_t %s_len = sizeof(%s);\n\n", sym, sym);
+}
+
+void write_resource(FILE* out, int mode, const char* sym, const char* path, int align)
+{
+  FILE* in = open_or_exit(path, "rb");
+  if (mode == MODE_INCBIN)
+    write_incbin(out, sym, path, size_or_exit(in, path), align);
+  else if (mode == MODE_EMBED)
+    write_embed(out, sym, path, align);
+  else
+    write_hex(out, sym, in, align);
+  fclose(in);
+}
+
+void close_or_exit(FILE* f, const char* fname)
+{
+  if (fclose(f) != 0) {
+    perror(fname);
+    exit(EXIT_FAILURE);
+  }
+}
+
+void* alloc_or_exit(size_t size)
+{
+  void* p = malloc(size ? size : 1);
+  if (p == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  return p;
+}
 
+// Reads all of `path` and lz_fast compresses it. Returns the bytes to store: the compressed
+// block, or the contents themselves when compression does not make them smaller (*stored ==
+// *size). The caller frees the result.
+unsigned char* read_compressed(const char* path, unsigned long long* size, unsigned long long* stored)
+{
+  FILE* in = open_or_exit(path, "rb");
+  size_t n = (size_t)size_or_exit(in, path);
+  unsigned char* raw = alloc_or_exit(n);
+  if (fread(raw, 1, n, in) != n) {
+    perror(path);
+    exit(EXIT_FAILURE);
+  }
   fclose(in);
-  fclose(out);
+  *size = n;
+  *stored = n;
+
+  unsigned char* packed = alloc_or_exit(lz_fast_bound(n));
+  size_t packedn = lz_fast_compress(raw, n, packed);
+  if (packedn >= n) {
+    free(packed);
+    return raw;
+  }
+  free(raw);
+  *stored = packedn;
+  return packed;
+}
+
+// Compresses `path` into {dir}/{sym}.lz for the single-file output to embed instead. Returns
+// the path to embed (the original when compression did not help) and the uncompressed size.
+const char* write_compressed(const char* dir, const char* sym, const char* path, char* lzpath, size_t lzpath_size, unsigned long long* size)
+{
+  unsigned long long stored = 0;
+  unsigned char* bytes = read_compressed(path, size, &stored);
+  if (stored == *size) {
+    free(bytes);
+    return path;
+  }
+  snprintf(lzpath, lzpath_size, "%s/%s.lz", dir, sym);
+  FILE* out = open_or_exit(lzpath, "wb");
+  fwrite(bytes, 1, (size_t)stored, out);
+  close_or_exit(out, lzpath);
+  free(bytes);
+  return lzpath;
+}
+
+// Packs every file named in `listfile` into {dir}/{sym}.pack and embeds that as {sym}. Each
+// line is "- path" for a file stored as is or "z path" for one to compress. Each entry is
+// followed by at least one 0 and padded with zeros to `align`, so entries keep the
+// single-file ABI: their data is 0-terminated and their length counts the terminator.
+// {sym}.h gives every entry's offset as a constant ({sym}_offset_{i}), so static tables can
+// point into the pack; {sym}_lens[i] is its stored length and {sym}_sizes[i] its
+// uncompressed one.
+void write_pack(FILE* out, FILE* header, int mode, const char* sym, const char* dir, const char* listfile, int align)
+{
+  char packfile[1024];
+  snprintf(packfile, sizeof(packfile), "%s/%s.pack", dir, sym);
+  FILE* list = open_or_exit(listfile, "r");
+  FILE* pack = open_or_exit(packfile, "wb");
+
+  fprintf(header, "// Auto-generated resource pack table\n\n");
+  fprintf(header, "#ifndef %s_H\n#define %s_H\n\n", sym, sym);
+  fprintf(header, "extern const unsigned char %s[];\n", sym);
+  fprintf(header, "extern const unsigned long long %s_len;\n", sym);
+  fprintf(header, "extern const unsigned long long %s_lens[];\n", sym);
+  fprintf(header, "extern const unsigned long long %s_sizes[];\n\n", sym);
+
+  static const char zeros[4096];
+  static unsigned char buf[1 << 16];
+  char line[1024];
+  unsigned long long offset = 0;
+  unsigned count = 0;
+  char* lens = NULL;
+  char* sizes = NULL;
+  size_t lens_size = 0;
+  size_t sizes_size = 0;
+  while (fgets(line, sizeof(line), list)) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (strlen(line) < 3)
+      continue;
+    const char* path = line + 2;
+    unsigned long long size = 0;
+    unsigned long long stored = 0;
+    if (line[0] == 'z') {
+      unsigned char* bytes = read_compressed(path, &size, &stored);
+      fwrite(bytes, 1, (size_t)stored, pack);
+      free(bytes);
+    } else {
+      FILE* in = open_or_exit(path, "rb");
+      size_t nread = 0;
+      while ((nread = fread(buf, 1, sizeof(buf), in)) > 0) {
+        fwrite(buf, 1, nread, pack);
+        size += nread;
+      }
+      fclose(in);
+      stored = size;
+    }
+    unsigned long long end = (offset + stored + 1 + align - 1) / align * align;
+    for (unsigned long long pad = end - offset - stored; pad > 0; ) {
+      size_t n = pad < sizeof(zeros) ? (size_t)pad : sizeof(zeros);
+      fwrite(zeros, 1, n, pack);
+      pad -= n;
+    }
+    fprintf(header, "#define %s_offset_%u %lluull\n", sym, count, offset);
+
+    char entry[32];
+    int n = snprintf(entry, sizeof(entry), "%lluull, ", stored + 1);
+    lens = realloc(lens, lens_size + (size_t)n + 2);
+    memcpy(lens + lens_size, entry, (size_t)n);
+    lens_size += (size_t)n;
+    n = snprintf(entry, sizeof(entry), "%lluull, ", size + 1);
+    sizes = realloc(sizes, sizes_size + (size_t)n + 2);
+    memcpy(sizes + sizes_size, entry, (size_t)n);
+    sizes_size += (size_t)n;
+    if (++count % 8 == 0) {
+      lens[lens_size++] = '\n';
+      sizes[sizes_size++] = '\n';
+    }
+    offset = end;
+  }
+  fclose(list);
+  close_or_exit(pack, packfile);
+
+  fprintf(header, "\n#define %s_count %u\n\n#endif\n", sym, count);
+
+  write_resource(out, mode, sym, packfile, align);
+  fprintf(out, "const unsigned long long %s_lens[] = {\n", sym);
+  if (lens_size) fwrite(lens, 1, lens_size, out);
+  fprintf(out, "0};\n");
+  fprintf(out, "const unsigned long long %s_sizes[] = {\n", sym);
+  if (sizes_size) fwrite(sizes, 1, sizes_size, out);
+  fprintf(out, "0};\n");
+  free(lens);
+  free(sizes);
+}
+
+int main(int argc, char** argv)
+{
+  int mode = MODE_HEX;
+  int align = 16;
+  const char* dir = ".";
+  const char* listfile = NULL;
+  int compress = 0;
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    const char* opt = argv[arg];
+    const char* value = argv[arg + 1];
+    if (strcmp(opt, "-z") == 0) {
+      compress = 1;
+      arg -= 1;
+    } else if (strcmp(opt, "-m") == 0) {
+      if (strcmp(value, "incbin") == 0) mode = MODE_INCBIN;
+      else if (strcmp(value, "embed") == 0) mode = MODE_EMBED;
+      else if (strcmp(value, "hex") == 0) mode = MODE_HEX;
+      else {
+        fprintf(stderr, "Unknown mode: %s\n", value);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(opt, "-a") == 0) {
+      align = atoi(value);
+      if (align <= 0 || (align & (align - 1))) {
+        fprintf(stderr, "Alignment must be a power of two: %s\n", value);
+        return EXIT_FAILURE;
+      }
+    } else if (strcmp(opt, "-o") == 0) {
+      dir = value;
+    } else if (strcmp(opt, "-l") == 0) {
+      listfile = value;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", opt);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - arg < (listfile ? 1 : 2)) {
+    fprintf(stderr, "USAGE: %s [-m incbin|embed|hex] [-a align] [-o dir] [-z] {sym} {rsrc}\n"
+        "       %s [-m incbin|embed|hex] [-a align] [-o dir] -l {list} {sym}\n\n"
+        "  Creates {dir}/{sym}.c from the contents of {rsrc} (lz_fast compressed\n"
+        "  with -z), or packs the files listed in {list} (\"- path\" stored,\n"
+        "  \"z path\" compressed) into {dir}/{sym}.pack, embeds that and writes\n"
+        "  their offsets to {dir}/{sym}.h\n"
+        "  incbin: .incbin in top-level asm (GCC, Clang)\n"
+        "  embed:  C23 #embed\n"
+        "  hex:    byte array literal (default, any compiler)\n",
+        argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char* sym = argv[arg];
+
+  char symfile[1024];
+  snprintf(symfile, sizeof(symfile), "%s/%s.c", dir, sym);
+
+  FILE* out = open_or_exit(symfile,"w");
+  if (listfile) {
+    char headerfile[1024];
+    snprintf(headerfile, sizeof(headerfile), "%s/%s.h", dir, sym);
+    FILE* header = open_or_exit(headerfile, "w");
+    write_pack(out, header, mode, sym, dir, listfile, align);
+    close_or_exit(header, headerfile);
+  } else if (compress) {
+    char lzpath[1024];
+    unsigned long long size = 0;
+    const char* path = write_compressed(dir, sym, argv[arg + 1], lzpath, sizeof(lzpath), &size);
+    write_resource(out, mode, sym, path, align);
+    fprintf(out, "const unsigned long long %s_size = %lluull;\n", sym, size + 1);
+  } else {
+    write_resource(out, mode, sym, argv[arg + 1], align);
+  }
+  close_or_exit(out, symfile);
 
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Per-frame timings of the host loop. The render thread records one entry per frame into a
+// fixed ring and publishes it with a release store of the frame counter, so readers (the
+// overlay, a dump, another thread) never block the frame. A phase may run several times per
+// frame (fixed-step updates), which sums its time, or nest in another one (a save inside input
+// handling), which pauses the outer phase, so every phase counts only its own time. Traces
+// show each phase from its first start to its last end.
+struct FrameProfiler {
+    enum Phase {
+        PHASE_RELOAD,
+        PHASE_INPUT,
+        PHASE_SAVE,
+        PHASE_UPDATE,
+        PHASE_DRAW,
+        PHASE_COUNT
+    };
+
+    static constexpr const char* PHASE_NAMES[PHASE_COUNT] = {"reload", "input", "save", "update", "draw"};
+
+    struct Frame {
+        std::uint64_t index = 0;
+        double start = 0;
+        double total = 0;
+        double phase[PHASE_COUNT] = {};
+        double phaseStart[PHASE_COUNT] = {};
+        double phaseEnd[PHASE_COUNT] = {};
+    };
+
+    struct Stats {
+        double p50 = 0, p99 = 0, max = 0;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<Frame> ring;
+    std::atomic<std::uint64_t> frames = 0;
+    Frame current;
+    Clock::time_point origin = Clock::now();
+    Clock::time_point frameStart, phaseBegin[PHASE_COUNT];
+    Phase open[PHASE_COUNT];
+    int depth = 0;
+
+    explicit FrameProfiler(std::size_t capacity = 1024) :
+        ring(capacity)
+    {}
+
+    // Times the enclosing block as `phase`.
+    struct Scope {
+        FrameProfiler& profiler;
+        Phase phase;
+        Scope(FrameProfiler& profiler, Phase phase) : profiler(profiler), phase(phase) { profiler.begin(phase); }
+        ~Scope() { profiler.end(phase); }
+    };
+
+    Scope scope(Phase phase) {
+        return Scope(*this, phase);
+    }
+
+    void beginFrame() {
+        frameStart = Clock::now();
+        current = {};
+        current.index = frames.load(std::memory_order_relaxed);
+        current.start = seconds(frameStart - origin);
+        for (auto& s : current.phaseStart)
+            s = -1;
+        depth = 0;
+    }
+
+    void begin(Phase phase) {
+        auto now = Clock::now();
+        if (depth > 0)
+            current.phase[open[depth - 1]] += seconds(now - phaseBegin[open[depth - 1]]);
+        if (depth < PHASE_COUNT)
+            open[depth++] = phase;
+        phaseBegin[phase] = now;
+        if (current.phaseStart[phase] < 0)
+            current.phaseStart[phase] = seconds(now - frameStart);
+    }
+
+    void end(Phase phase) {
+        auto now = Clock::now();
+        current.phase[phase] += seconds(now - phaseBegin[phase]);
+        current.phaseEnd[phase] = seconds(now - frameStart);
+        if (depth > 0 && --depth > 0)
+            phaseBegin[open[depth - 1]] = now;
+    }
+
+    void endFrame() {
+        current.total = seconds(Clock::now() - frameStart);
+        auto n = frames.load(std::memory_order_relaxed);
+        ring[n % ring.size()] = current;
+        frames.store(n + 1, std::memory_order_release);
+    }
+
+    // Up to `count` of the newest frames, oldest first. Only consistent on the recording
+    // thread; elsewhere entries may be overwritten while they are copied.
+    std::vector<Frame> last(std::size_t count) const {
+        auto n = frames.load(std::memory_order_acquire);
+        count = std::min<std::size_t>({count, ring.size(), std::size_t(n)});
+        std::vector<Frame> out;
+        out.reserve(count);
+        for (auto i = n - count; i < n; ++i)
+            out.push_back(ring[i % ring.size()]);
+        return out;
+    }
+
+    // Percentiles of a phase (or of the whole frame with PHASE_COUNT) over the newest `count`
+    // frames, in seconds.
+    Stats stats(int phase, std::size_t count) const {
+        auto recent = last(count);
+        std::vector<double> t;
+        t.reserve(recent.size());
+        for (auto& f : recent)
+            t.push_back(phase == PHASE_COUNT ? f.total : f.phase[phase]);
+        Stats s;
+        if (t.empty())
+            return s;
+        std::sort(t.begin(), t.end());
+        s.p50 = t[t.size() / 2];
+        s.p99 = t[std::min(t.size() - 1, t.size() * 99 / 100)];
+        s.max = t.back();
+        return s;
+    }
+
+    bool writeCsv(const std::filesystem::path& path) const {
+        std::ofstream out(path);
+        out << "frame,start_ms,total_ms";
+        for (auto name : PHASE_NAMES)
+            out << "," << name << "_ms";
+        out << "\n";
+        for (auto& f : last(ring.size())) {
+            out << f.index << "," << f.start * 1e3 << "," << f.total * 1e3;
+            for (auto p : f.phase)
+                out << "," << p * 1e3;
+            out << "\n";
+        }
+        return bool(out);
+    }
+
+    // Chrome trace event format (chrome://tracing, Perfetto): one complete event per frame and
+    // per phase that ran in it.
+    bool writeChromeTrace(const std::filesystem::path& path) const {
+        std::ofstream out(path);
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        auto event = [&](const char* name, double start, double duration, std::uint64_t index) {
+            out << (first ? "\n" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                << start * 1e6 << ",\"dur\":" << duration * 1e6 << ",\"args\":{\"frame\":" << index << "}}";
+            first = false;
+        };
+        for (auto& f : last(ring.size())) {
+            event("frame", f.start, f.total, f.index);
+            for (int p = 0; p < PHASE_COUNT; ++p)
+                if (f.phaseStart[p] >= 0)
+                    event(PHASE_NAMES[p], f.start + f.phaseStart[p], f.phaseEnd[p] - f.phaseStart[p], f.index);
+        }
+        out << "\n]}\n";
+        return bool(out);
+    }
+
+    // Writes `<name>.csv` and `<name>.json`, logging a failure.
+    bool dump(const std::string& name) const {
+        auto csv = name + ".csv", trace = name + ".json";
+        if (writeCsv(csv) && writeChromeTrace(trace))
+            return true;
+        std::cerr << "Failed to write " << csv << " / " << trace << std::endl;
+        return false;
+    }
+
+    // " | phase p50/p99/max" in milliseconds over the newest `count` frames for every phase
+    // that ran, then the same for the whole frame; the hosts put it in the window title.
+    std::string summary(std::size_t count) const {
+        std::string text;
+        char part[64];
+        for (int p = 0; p <= PHASE_COUNT; ++p) {
+            auto st = stats(p, count);
+            if (p < PHASE_COUNT && st.max == 0)
+                continue;
+            std::snprintf(part, sizeof(part), " | %s %.1f/%.1f/%.1f", p < PHASE_COUNT ? PHASE_NAMES[p] : "frame", st.p50 * 1e3, st.p99 * 1e3, st.max * 1e3);
+            text += part;
+        }
+        return text;
+    }
+
+private:
+    static double seconds(Clock::duration d) {
+        return std::chrono::duration<double>(d).count();
+    }
+};
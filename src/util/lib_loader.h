@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Loads libraries on a worker thread and hands them to the render loop through a single
+// atomic pointer. The render loop calls take() at a frame boundary; libraries that are no
+// longer in use are handed back with retire() so that unloading also happens off-thread.
+template <typename Lib>
+struct LibLoader {
+    std::function<std::unique_ptr<Lib>()> load;
+    std::function<void(std::unique_ptr<Lib>)> unload;
+
+    std::atomic<Lib*> pending = nullptr;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool requested = false;
+    bool running = false;
+    std::vector<std::unique_ptr<Lib>> retired;
+    std::thread thread;
+
+    LibLoader(std::function<std::unique_ptr<Lib>()> load, std::function<void(std::unique_ptr<Lib>)> unload = nullptr) :
+        load(std::move(load)),
+        unload(std::move(unload))
+    { }
+
+    ~LibLoader() {
+        stop();
+        for (auto& lib : retired)
+            dispose(std::move(lib));
+        dispose(std::unique_ptr<Lib>(pending.exchange(nullptr)));
+    }
+
+    LibLoader(const LibLoader&) = delete;
+    LibLoader& operator=(const LibLoader&) = delete;
+
+    void start() {
+        std::lock_guard lock(mutex);
+        if (running)
+            return;
+        running = true;
+        thread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard lock(mutex);
+            running = false;
+        }
+        cv.notify_one();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    void request() {
+        {
+            std::lock_guard lock(mutex);
+            requested = true;
+        }
+        cv.notify_one();
+    }
+
+    // Render thread: returns the freshly loaded library, if any. A relaxed load when idle.
+    std::unique_ptr<Lib> take() {
+        if (!pending.load(std::memory_order_relaxed))
+            return nullptr;
+        return std::unique_ptr<Lib>(pending.exchange(nullptr, std::memory_order_acquire));
+    }
+
+    void retire(std::unique_ptr<Lib> lib) {
+        if (!lib)
+            return;
+        {
+            std::lock_guard lock(mutex);
+            retired.push_back(std::move(lib));
+        }
+        cv.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return !running || requested || !retired.empty(); });
+            auto toUnload = std::move(retired);
+            retired.clear();
+            bool doLoad = requested && running;
+            requested = false;
+            bool stopping = !running;
+            lock.unlock();
+
+            for (auto& lib : toUnload)
+                dispose(std::move(lib));
+            if (doLoad) {
+                if (auto lib = load()) {
+                    // A library nobody picked up yet is superseded by the newer one.
+                    dispose(std::unique_ptr<Lib>(pending.exchange(lib.release(), std::memory_order_release)));
+                }
+            }
+
+            lock.lock();
+            if (stopping && retired.empty())
+                break;
+        }
+    }
+
+    void dispose(std::unique_ptr<Lib> lib) {
+        if (lib && unload)
+            unload(std::move(lib));
+    }
+};
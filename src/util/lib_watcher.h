@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Watches for a published GAME_NEW library on a background thread so the render
+// loop only pays for one atomic load per frame. On Linux the watcher is backed
+// by inotify; elsewhere (or if inotify is unavailable) it falls back to a
+// rate-limited stat poll.
+struct LibWatcher {
+    using clock = std::chrono::steady_clock;
+
+    std::filesystem::path dir, file;
+    std::chrono::milliseconds debounce, pollInterval;
+    std::atomic<bool> ready = false;
+    std::atomic<bool> running = false;
+    std::thread thread;
+
+    LibWatcher(const std::filesystem::path& fullPath,
+        std::chrono::milliseconds debounce = std::chrono::milliseconds(150),
+        std::chrono::milliseconds pollInterval = std::chrono::milliseconds(250)) :
+        dir(fullPath.parent_path()),
+        file(fullPath.filename()),
+        debounce(debounce),
+        pollInterval(pollInterval)
+    { }
+
+    ~LibWatcher() {
+        stop();
+    }
+
+    LibWatcher(const LibWatcher&) = delete;
+    LibWatcher& operator=(const LibWatcher&) = delete;
+
+    void start() {
+        if (running.exchange(true))
+            return;
+        // A library published while the host was not running must be picked up by the first check.
+        if (exists())
+            ready.store(true, std::memory_order_release);
+        thread = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        running.store(false);
+        if (thread.joinable())
+            thread.join();
+    }
+
+    // Returns true once per publish. Costs a single relaxed load when nothing changed.
+    bool consume() {
+        if (!ready.load(std::memory_order_relaxed))
+            return false;
+        return ready.exchange(false, std::memory_order_acq_rel);
+    }
+
+private:
+    bool exists() const {
+        std::error_code ec;
+        return std::filesystem::exists(dir / file, ec);
+    }
+
+    void run() {
+#if defined(__linux__)
+        if (runInotify())
+            return;
+#endif
+        runPolling();
+    }
+
+    // The publish step writes a temp file and renames it over GAME_NEW, so we only care about
+    // the final name appearing. Several quick publishes (or a rename racing a close) are
+    // collapsed into one signal by waiting until the file has been quiet for `debounce`.
+    void signalAfterQuiet(clock::time_point& pendingSince) {
+        if (pendingSince == clock::time_point() || clock::now() - pendingSince < debounce)
+            return;
+        pendingSince = clock::time_point();
+        if (exists())
+            ready.store(true, std::memory_order_release);
+    }
+
+#if defined(__linux__)
+    bool runInotify() {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            return false;
+        if (inotify_add_watch(fd, dir.c_str(), IN_MOVED_TO | IN_CLOSE_WRITE | IN_CREATE) < 0) {
+            close(fd);
+            return false;
+        }
+
+        const std::string name = file.string();
+        alignas(inotify_event) char buf[4096];
+        clock::time_point pendingSince;
+        while (running.load(std::memory_order_relaxed)) {
+            pollfd pfd = {fd, POLLIN, 0};
+            int timeout = int(std::chrono::duration_cast<std::chrono::milliseconds>(pendingSince == clock::time_point() ? std::chrono::milliseconds(100) : debounce).count());
+            if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN)) {
+                ssize_t len;
+                while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                    for (char* p = buf; p < buf + len; ) {
+                        auto* ev = (inotify_event*)p;
+                        if (ev->len && name == ev->name)
+                            pendingSince = clock::now();
+                        p += sizeof(inotify_event) + ev->len;
+                    }
+                }
+            }
+            signalAfterQuiet(pendingSince);
+        }
+        close(fd);
+        return true;
+    }
+#endif
+
+    void runPolling() {
+        const auto step = std::chrono::milliseconds(50);
+        auto nextPoll = clock::now();
+        clock::time_point pendingSince;
+        std::filesystem::file_time_type lastWrite;
+        bool seen = false;
+        while (running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(step);
+            if (clock::now() < nextPoll)
+                continue;
+            nextPoll = clock::now() + pollInterval;
+            std::error_code ec;
+            auto wt = std::filesystem::last_write_time(dir / file, ec);
+            if (ec) {
+                seen = false;
+                pendingSince = clock::time_point();
+                continue;
+            }
+            if (!seen || wt != lastWrite) {
+                seen = true;
+                lastWrite = wt;
+                pendingSince = clock::now();
+            }
+            signalAfterQuiet(pendingSince);
+        }
+    }
+};
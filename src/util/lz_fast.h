@@ -0,0 +1,136 @@
+#ifndef LZ_FAST_H
+#define LZ_FAST_H
+
+/*
+  Small LZ77 block codec in the spirit of LZ4: greedy matching through a 4-byte hash table,
+  sequences of <token><literals><offset><match length>. It trades ratio for speed and has
+  no dependencies, so both the host and the build tools can use it.
+
+  token: high nibble literal count, low nibble match length - 4 (15 = more bytes follow,
+  each adding 0..255, terminated by a byte < 255). offset: 2 bytes little endian, 1..65535.
+  The block always ends with a literal-only sequence.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_FAST_HASH_BITS 14
+#define LZ_FAST_MIN_MATCH 4
+#define LZ_FAST_MAX_OFFSET 65535
+
+/* Worst case compressed size of `n` input bytes. */
+static inline size_t lz_fast_bound(size_t n)
+{
+  return n + n / 255 + 16;
+}
+
+static inline uint32_t lz_fast_read32(const uint8_t* p)
+{
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint32_t lz_fast_hash(uint32_t v)
+{
+  return (v * 2654435761u) >> (32 - LZ_FAST_HASH_BITS);
+}
+
+static inline uint8_t* lz_fast_put_length(uint8_t* op, size_t len)
+{
+  while (len >= 255) { *op++ = 255; len -= 255; }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+static inline uint8_t* lz_fast_put_sequence(uint8_t* op, const uint8_t* lit, size_t nlit, size_t offset, size_t mlen)
+{
+  uint8_t* token = op++;
+  size_t mcode = mlen ? mlen - LZ_FAST_MIN_MATCH : 0;
+  *token = (uint8_t)(((nlit < 15 ? nlit : 15) << 4) | (mcode < 15 ? mcode : 15));
+  if (nlit >= 15) op = lz_fast_put_length(op, nlit - 15);
+  memcpy(op, lit, nlit);
+  op += nlit;
+  if (mlen) {
+    *op++ = (uint8_t)(offset & 0xff);
+    *op++ = (uint8_t)(offset >> 8);
+    if (mcode >= 15) op = lz_fast_put_length(op, mcode - 15);
+  }
+  return op;
+}
+
+/* Compresses `n` bytes into `dst`, which must hold lz_fast_bound(n) bytes. Returns the
+   compressed size. */
+static inline size_t lz_fast_compress(const uint8_t* src, size_t n, uint8_t* dst)
+{
+  uint32_t table[1 << LZ_FAST_HASH_BITS];
+  const uint8_t* ip = src;
+  const uint8_t* anchor = src;
+  const uint8_t* end = src + n;
+  uint8_t* op = dst;
+  memset(table, 0, sizeof(table));
+
+  if (n >= LZ_FAST_MIN_MATCH + 1) {
+    const uint8_t* limit = end - LZ_FAST_MIN_MATCH;
+    while (ip < limit) {
+      uint32_t seq = lz_fast_read32(ip);
+      uint32_t h = lz_fast_hash(seq);
+      const uint8_t* ref = src + table[h];
+      table[h] = (uint32_t)(ip - src);
+      if (ref >= ip || (size_t)(ip - ref) > LZ_FAST_MAX_OFFSET || lz_fast_read32(ref) != seq) {
+        ip++;
+        continue;
+      }
+      const uint8_t* mp = ip + LZ_FAST_MIN_MATCH;
+      const uint8_t* rp = ref + LZ_FAST_MIN_MATCH;
+      while (mp < end && *mp == *rp) { mp++; rp++; }
+      op = lz_fast_put_sequence(op, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), (size_t)(mp - ip));
+      ip = anchor = mp;
+    }
+  }
+  return (size_t)(lz_fast_put_sequence(op, anchor, (size_t)(end - anchor), 0, 0) - dst);
+}
+
+/* Decompresses a block into exactly `n` bytes of `dst`. Returns 0 on malformed input. */
+static inline int lz_fast_decompress(const uint8_t* src, size_t srcn, uint8_t* dst, size_t n)
+{
+  const uint8_t* ip = src;
+  const uint8_t* iend = src + srcn;
+  uint8_t* op = dst;
+  uint8_t* oend = dst + n;
+  while (ip < iend) {
+    unsigned token = *ip++;
+    size_t nlit = token >> 4;
+    if (nlit == 15) {
+      unsigned b;
+      do { if (ip >= iend) return 0; b = *ip++; nlit += b; } while (b == 255);
+    }
+    if ((size_t)(iend - ip) < nlit || (size_t)(oend - op) < nlit) return 0;
+    memcpy(op, ip, nlit);
+    op += nlit;
+    ip += nlit;
+    if (ip == iend) break;
+
+    if (iend - ip < 2) return 0;
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    size_t mlen = (token & 15);
+    if (mlen == 15) {
+      unsigned b;
+      do { if (ip >= iend) return 0; b = *ip++; mlen += b; } while (b == 255);
+    }
+    mlen += LZ_FAST_MIN_MATCH;
+    if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(oend - op) < mlen) return 0;
+    const uint8_t* ref = op - offset;
+    if (offset >= mlen) {
+      memcpy(op, ref, mlen);
+      op += mlen;
+    } else {
+      while (mlen--) *op++ = *ref++;
+    }
+  }
+  return op == oend;
+}
+
+#endif
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+// Keep windows.h from clashing with raylib (Rectangle, CloseWindow, DrawText, ...).
+#ifndef NOGDI
+#define NOGDI
+#endif
+#ifndef NOUSER
+#define NOUSER
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A file mapped into memory, either read-only (for deserializing in place) or read-write with
+// a caller-chosen size (for serializing straight into the page cache). Writable mappings are
+// truncated to the number of bytes actually used when closed.
+struct MappedFile {
+    std::byte* data = nullptr;
+    std::size_t size = 0;
+    bool writable = false;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    std::span<std::byte> bytes() { return {data, size}; }
+    std::span<const std::byte> bytes() const { return {data, size}; }
+
+    bool openRead(const std::filesystem::path& path) {
+        close();
+#if defined(_WIN32)
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER fileSize;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+            return close(), false;
+        size = std::size_t(fileSize.QuadPart);
+#else
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+            return close(), false;
+        size = std::size_t(st.st_size);
+#endif
+        return map();
+    }
+
+    // Creates (or truncates) `path` and maps `initialSize` writable bytes of it.
+    bool openWrite(const std::filesystem::path& path, std::size_t initialSize) {
+        close();
+        writable = true;
+#if defined(_WIN32)
+        file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return close(), false;
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return close(), false;
+#endif
+        return resize(initialSize);
+    }
+
+    // Grows or shrinks a writable mapping; the contents up to the smaller size are kept.
+    bool resize(std::size_t newSize) {
+        unmap();
+        if (!setFileSize(newSize))
+            return false;
+        size = newSize;
+        return map();
+    }
+
+    // Starts readahead for a range that is about to be read front to back, instead of
+    // faulting it in page by page.
+    void prefetch(std::size_t offset = 0, std::size_t length = std::size_t(-1)) {
+        if (!data || offset >= size)
+            return;
+        length = std::min(length, size - offset);
+#if defined(_WIN32)
+        WIN32_MEMORY_RANGE_ENTRY range = {data + offset, length};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+        std::size_t begin = offset / page * page;
+        madvise(data + begin, offset + length - begin, MADV_SEQUENTIAL);
+        madvise(data + begin, offset + length - begin, MADV_WILLNEED);
+#endif
+    }
+
+    bool sync() {
+#if defined(_WIN32)
+        return (!data || FlushViewOfFile(data, size)) && FlushFileBuffers(file);
+#else
+        return (!data || msync(data, size, MS_SYNC) == 0) && fsync(fd) == 0;
+#endif
+    }
+
+    // Unmaps and closes. A writable file is first truncated to `usedSize` bytes.
+    void close(std::size_t usedSize = std::size_t(-1)) {
+        unmap();
+        if (writable && isFileOpen() && usedSize != std::size_t(-1))
+            setFileSize(usedSize);
+#if defined(_WIN32)
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#endif
+        size = 0;
+        writable = false;
+    }
+
+private:
+    bool isFileOpen() const {
+#if defined(_WIN32)
+        return file != INVALID_HANDLE_VALUE;
+#else
+        return fd >= 0;
+#endif
+    }
+
+    bool setFileSize(std::size_t newSize) {
+#if defined(_WIN32)
+        LARGE_INTEGER li;
+        li.QuadPart = LONGLONG(newSize);
+        return SetFilePointerEx(file, li, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+#else
+        return ftruncate(fd, off_t(newSize)) == 0;
+#endif
+    }
+
+    // Empty files cannot be mapped; they are represented by a null span.
+    bool map() {
+        if (size == 0)
+            return true;
+#if defined(_WIN32)
+        mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+            return close(), false;
+        data = (std::byte*)MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+#else
+        void* p = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        data = p == MAP_FAILED ? nullptr : (std::byte*)p;
+#endif
+        if (!data)
+            return close(), false;
+        return true;
+    }
+
+    void unmap() {
+#if defined(_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        if (data)
+            munmap(data, size);
+#endif
+        data = nullptr;
+    }
+};
+
+// Flushes whatever has been written to `path` through any handle down to the disk.
+inline bool syncFile(const std::filesystem::path& path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    bool ok = FlushFileBuffers(file);
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+#endif
+    return ok;
+}
+
+// Maps `file` down to `used` bytes, optionally flushes it and renames `tmp` over `path`.
+inline bool commitMapped(MappedFile& file, std::size_t used, bool durable, const std::filesystem::path& tmp, const std::filesystem::path& path) {
+    bool written = file.resize(used) && (!durable || file.sync());
+    file.close();
+    std::error_code ec;
+    if (written)
+        std::filesystem::rename(tmp, path, ec);
+    if (!written || ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// Writes `bytes` through a mapping of `<path>.tmp` and renames it over `path`, so readers
+// never see a partial save. With `durable` the data is flushed to disk before the rename.
+inline bool writeMappedBytes(const std::filesystem::path& path, std::span<const std::byte> bytes, bool durable) {
+    auto tmp = path;
+    tmp += ".tmp";
+    MappedFile file;
+    if (!file.openWrite(tmp, bytes.size()))
+        return false;
+    if (!bytes.empty())
+        std::memcpy(file.data, bytes.data(), bytes.size());
+    return commitMapped(file, bytes.size(), durable, tmp, path);
+}
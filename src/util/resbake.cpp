@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "raylib.h"
+
+#include "baked_resource.h"
+
+// Build-time tool behind embed_resources' BAKE_IMAGES and BAKE_SOUNDS: decodes an image or a
+// sound with raylib once, at build time, and writes it in the layout of baked_resource.h.
+
+static bool writeBaked(const std::filesystem::path& path, const void* header, std::size_t headerSize, const void* data, std::uint64_t dataSize) {
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char*)header, std::streamsize(headerSize));
+    out.write((const char*)data, std::streamsize(dataSize));
+    if (!out) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool bakeImage(const char* in, const char* out, bool mipmaps) {
+    Image image = LoadImage(in);
+    if (!IsImageValid(image)) {
+        std::cerr << "Failed to load image " << in << std::endl;
+        return false;
+    }
+    if (mipmaps)
+        ImageMipmaps(&image);
+    BakedImageHeader header = {};
+    std::memcpy(header.magic, BakedImageHeader::MAGIC, 4);
+    header.version = BakedImageHeader::VERSION;
+    header.width = image.width;
+    header.height = image.height;
+    header.mipmaps = image.mipmaps;
+    header.format = image.format;
+    header.dataSize = bakedImageDataSize(image.width, image.height, image.mipmaps, image.format);
+    bool ok = writeBaked(out, &header, sizeof(header), image.data, header.dataSize);
+    UnloadImage(image);
+    return ok;
+}
+
+static bool bakeWave(const char* in, const char* out) {
+    Wave wave = LoadWave(in);
+    if (!IsWaveValid(wave)) {
+        std::cerr << "Failed to load sound " << in << std::endl;
+        return false;
+    }
+    BakedWaveHeader header = {};
+    std::memcpy(header.magic, BakedWaveHeader::MAGIC, 4);
+    header.version = BakedWaveHeader::VERSION;
+    header.frameCount = wave.frameCount;
+    header.sampleRate = wave.sampleRate;
+    header.sampleSize = wave.sampleSize;
+    header.channels = wave.channels;
+    header.dataSize = std::uint64_t(wave.frameCount) * wave.channels * (wave.sampleSize / 8);
+    bool ok = writeBaked(out, &header, sizeof(header), wave.data, header.dataSize);
+    UnloadWave(wave);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::string kind = argc > 1 ? argv[1] : "";
+    bool mipmaps = argc > 2 && !std::strcmp(argv[2], "--mipmaps");
+    int arg = mipmaps ? 3 : 2;
+    if ((kind != "image" && kind != "wave") || argc - arg != 2) {
+        std::cerr << "USAGE: " << argv[0] << " image [--mipmaps] {in} {out}\n"
+            << "       " << argv[0] << " wave {in} {out}\n\n"
+            << "  Decodes {in} with raylib and writes its pixels (with a mip chain when asked)\n"
+            << "  or samples to {out} as baked_resource.h describes" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    bool ok = kind == "image" ? bakeImage(argv[arg], argv[arg + 1], mipmaps) : bakeWave(argv[arg], argv[arg + 1]);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "resource_tree.h"
+#include "lz_fast.h"
+
+// Contents of embedded resources, decompressing the ones embed_resources stored compressed
+// (COMPRESS_EXTENSIONS) on first access. Uncompressed resources are returned in place.
+// Decompressed copies stay until trim() drops the least recently used ones over the budget;
+// pinned ones are never dropped. Views stay valid until the resource is dropped, so call trim()
+// where no view is held (e.g. between frames or after loading a level).
+struct ResourceCache {
+    std::size_t budget;
+
+    explicit ResourceCache(std::size_t budget = 64 << 20) :
+        budget(budget)
+    {}
+
+    static bool compressed(const ResourceNode* node) {
+        return node && !node->is_dir && *node->len < *node->size;
+    }
+
+    // The contents without the terminating 0, which data()[size()] still holds. Empty for
+    // directories, missing or corrupt resources.
+    std::span<const std::byte> get(const ResourceNode* node, bool pin = false) {
+        if (!node || node->is_dir)
+            return {};
+        if (!compressed(node))
+            return {(const std::byte*)node->data, std::size_t(*node->len - 1)};
+
+        std::lock_guard lock(mutex);
+        auto& entry = entries[node];
+        entry.lastUse = ++uses;
+        entry.pins += pin;
+        if (entry.bytes.empty()) {
+            entry.bytes.resize(std::size_t(*node->size));
+            if (!lz_fast_decompress(node->data, std::size_t(*node->len - 1), (std::uint8_t*)entry.bytes.data(), entry.bytes.size() - 1)) {
+                std::cerr << "Failed to decompress resource " << node->path << std::endl;
+                entries.erase(node);
+                return {};
+            }
+            entry.bytes.back() = std::byte(0);
+            total += entry.bytes.size();
+        }
+        return {entry.bytes.data(), entry.bytes.size() - 1};
+    }
+
+    std::span<const std::byte> get(std::string_view path, bool pin = false) {
+        return get(findResource(path), pin);
+    }
+
+    // Keeps a resource decompressed until unpin(); pins nest.
+    void pin(const ResourceNode* node) {
+        if (compressed(node))
+            get(node, true);
+    }
+
+    void unpin(const ResourceNode* node) {
+        std::lock_guard lock(mutex);
+        auto it = entries.find(node);
+        if (it != entries.end() && it->second.pins > 0)
+            --it->second.pins;
+    }
+
+    // Drops unpinned copies, least recently used first, until the cache fits `budget`.
+    void trim() {
+        std::lock_guard lock(mutex);
+        while (total > budget) {
+            auto victim = entries.end();
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+                if (!it->second.pins && (victim == entries.end() || it->second.lastUse < victim->second.lastUse))
+                    victim = it;
+            if (victim == entries.end())
+                break;
+            total -= victim->second.bytes.size();
+            entries.erase(victim);
+        }
+    }
+
+    std::size_t size() const {
+        std::lock_guard lock(mutex);
+        return total;
+    }
+
+private:
+    struct Entry {
+        std::vector<std::byte> bytes;
+        std::uint64_t lastUse = 0;
+        int pins = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<const ResourceNode*, Entry> entries;
+    std::uint64_t uses = 0;
+    std::size_t total = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <iostream>
+
+#include "raylib.h"
+
+#include "baked_resource.h"
+#include "resource_cache.h"
+
+// raylib objects from embedded resources, whatever embed_resources did to them: baked images
+// and sounds (RESOURCE_FORMAT_IMAGE/WAVE) are used as stored, anything else is decoded from the
+// embedded file by its extension. Compressed resources go through `cache`.
+
+inline bool viewResourceImage(ResourceCache& cache, const ResourceNode* node, Image& image) {
+    return node && node->format == RESOURCE_FORMAT_IMAGE && viewBakedImage(cache.get(node), image);
+}
+
+inline bool viewResourceWave(ResourceCache& cache, const ResourceNode* node, Wave& wave) {
+    return node && node->format == RESOURCE_FORMAT_WAVE && viewBakedWave(cache.get(node), wave);
+}
+
+// An owned Image; UnloadImage() it.
+inline Image loadResourceImage(ResourceCache& cache, const ResourceNode* node) {
+    Image image = {};
+    if (viewResourceImage(cache, node, image))
+        return ImageCopy(image);
+    auto bytes = cache.get(node);
+    if (bytes.empty()) {
+        std::cerr << "Failed to load image resource " << (node ? node->path : "(null)") << std::endl;
+        return {};
+    }
+    return LoadImageFromMemory(GetFileExtension(node->name), (const unsigned char*)bytes.data(), int(bytes.size()));
+}
+
+// Baked images are uploaded straight from the resource, mip chain included.
+inline Texture2D loadResourceTexture(ResourceCache& cache, const ResourceNode* node) {
+    Image image = {};
+    if (viewResourceImage(cache, node, image))
+        return LoadTextureFromImage(image);
+    image = loadResourceImage(cache, node);
+    Texture2D texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    return texture;
+}
+
+// An owned Wave; UnloadWave() it.
+inline Wave loadResourceWave(ResourceCache& cache, const ResourceNode* node) {
+    Wave wave = {};
+    if (viewResourceWave(cache, node, wave))
+        return WaveCopy(wave);
+    auto bytes = cache.get(node);
+    if (bytes.empty()) {
+        std::cerr << "Failed to load sound resource " << (node ? node->path : "(null)") << std::endl;
+        return {};
+    }
+    return LoadWaveFromMemory(GetFileExtension(node->name), (const unsigned char*)bytes.data(), int(bytes.size()));
+}
+
+inline Sound loadResourceSound(ResourceCache& cache, const ResourceNode* node) {
+    Wave wave = {};
+    if (viewResourceWave(cache, node, wave))
+        return LoadSoundFromWave(wave);
+    wave = loadResourceWave(cache, node);
+    Sound sound = LoadSoundFromWave(wave);
+    UnloadWave(wave);
+    return sound;
+}
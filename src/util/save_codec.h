@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "lz_fast.h"
+
+// Compression stage between serialization and storage. Data is cut into independently
+// compressed chunks so it can be decompressed chunk by chunk straight into the output
+// buffer while the input is still being paged in:
+//
+//   "GBZ1" u8 codec, u8[3] 0, u64 raw size, u32 chunk size
+//   per chunk: u32 stored size, u32 raw size, stored bytes (raw if the codec did not help)
+//
+// The fast LZ codec is built in. Other codecs (e.g. a high-ratio one provided by the host)
+// are plugged in with registerCodec().
+enum SaveCodecId : std::uint8_t {
+    SAVE_CODEC_NONE = 0,
+    SAVE_CODEC_FAST = 1,
+    SAVE_CODEC_HIGH = 2,
+    SAVE_CODEC_COUNT
+};
+
+struct SaveCodec {
+    // Appends the compressed form of `in` to `out`; returns false to store the chunk raw.
+    bool (*compress)(std::span<const std::byte> in, std::vector<std::byte>& out) = nullptr;
+    // Decompresses into exactly out.size() bytes.
+    bool (*decompress)(std::span<const std::byte> in, std::span<std::byte> out) = nullptr;
+};
+
+struct SaveCompression {
+    static constexpr char MAGIC[4] = {'G', 'B', 'Z', '1'};
+    static constexpr std::size_t HEADER_SIZE = 20;
+    static constexpr std::size_t CHUNK_HEADER_SIZE = 8;
+    static constexpr std::uint32_t DEFAULT_CHUNK_SIZE = 1 << 20;
+
+    static std::array<SaveCodec, SAVE_CODEC_COUNT>& codecs() {
+        static std::array<SaveCodec, SAVE_CODEC_COUNT> table = [] {
+            std::array<SaveCodec, SAVE_CODEC_COUNT> t;
+            t[SAVE_CODEC_FAST] = {fastCompress, fastDecompress};
+            return t;
+        }();
+        return table;
+    }
+
+    static void registerCodec(SaveCodecId id, SaveCodec codec) {
+        codecs()[id] = codec;
+    }
+
+    static bool isCompressed(std::span<const std::byte> in) {
+        return in.size() >= HEADER_SIZE && !std::memcmp(in.data(), MAGIC, sizeof(MAGIC));
+    }
+
+    // Writes `in` as a chunked stream into `out` (replacing its contents). Unknown or
+    // unregistered codecs store every chunk raw.
+    static void compress(SaveCodecId id, std::span<const std::byte> in, std::vector<std::byte>& out, std::uint32_t chunkSize = DEFAULT_CHUNK_SIZE) {
+        const SaveCodec* codec = id < SAVE_CODEC_COUNT && codecs()[id].compress ? &codecs()[id] : nullptr;
+        out.clear();
+        out.resize(HEADER_SIZE);
+        std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+        out[4] = std::byte(codec ? id : SAVE_CODEC_NONE);
+        put(out.data() + 8, std::uint64_t(in.size()));
+        put(out.data() + 16, chunkSize);
+        for (std::size_t pos = 0; pos < in.size(); pos += chunkSize) {
+            auto chunk = in.subspan(pos, std::min<std::size_t>(chunkSize, in.size() - pos));
+            std::size_t at = out.size();
+            out.resize(at + CHUNK_HEADER_SIZE);
+            if (!codec || !codec->compress(chunk, out) || out.size() - at - CHUNK_HEADER_SIZE >= chunk.size()) {
+                out.resize(at + CHUNK_HEADER_SIZE);
+                out.insert(out.end(), chunk.begin(), chunk.end());
+            }
+            put(out.data() + at, std::uint32_t(out.size() - at - CHUNK_HEADER_SIZE));
+            put(out.data() + at + 4, std::uint32_t(chunk.size()));
+        }
+    }
+
+    // Decompresses a stream produced by compress(), one chunk at a time, into `out`.
+    static bool decompress(std::span<const std::byte> in, std::vector<std::byte>& out) {
+        if (!isCompressed(in))
+            return false;
+        auto id = std::uint8_t(in[4]);
+        std::uint64_t rawSize = get<std::uint64_t>(in.data() + 8);
+        const SaveCodec* codec = id < SAVE_CODEC_COUNT ? &codecs()[id] : nullptr;
+        if (id != SAVE_CODEC_NONE && (!codec || !codec->decompress))
+            return false;
+        out.resize(std::size_t(rawSize));
+        std::size_t pos = HEADER_SIZE, written = 0;
+        while (written < rawSize) {
+            if (in.size() - pos < CHUNK_HEADER_SIZE)
+                return false;
+            std::size_t stored = get<std::uint32_t>(in.data() + pos);
+            std::size_t raw = get<std::uint32_t>(in.data() + pos + 4);
+            pos += CHUNK_HEADER_SIZE;
+            if (in.size() - pos < stored || rawSize - written < raw)
+                return false;
+            auto src = in.subspan(pos, stored);
+            auto dst = std::span<std::byte>(out).subspan(written, raw);
+            if (stored == raw)
+                std::memcpy(dst.data(), src.data(), raw);
+            else if (!codec->decompress(src, dst))
+                return false;
+            pos += stored;
+            written += raw;
+        }
+        return true;
+    }
+
+private:
+    template <typename T>
+    static void put(std::byte* p, T v) {
+        std::memcpy(p, &v, sizeof(v));
+    }
+
+    template <typename T>
+    static T get(const std::byte* p) {
+        T v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static bool fastCompress(std::span<const std::byte> in, std::vector<std::byte>& out) {
+        std::size_t at = out.size();
+        out.resize(at + lz_fast_bound(in.size()));
+        std::size_t n = lz_fast_compress((const std::uint8_t*)in.data(), in.size(), (std::uint8_t*)out.data() + at);
+        out.resize(at + n);
+        return true;
+    }
+
+    static bool fastDecompress(std::span<const std::byte> in, std::span<std::byte> out) {
+        return lz_fast_decompress((const std::uint8_t*)in.data(), in.size(), (std::uint8_t*)out.data(), out.size());
+    }
+};
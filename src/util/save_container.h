@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// One entry of the container index.
+struct SaveSlot {
+    char name[48];
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t frame;
+    std::int64_t timestamp;
+    std::uint32_t checksum;
+    std::uint32_t reserved;
+};
+static_assert(sizeof(SaveSlot) == 88);
+
+struct SaveContainerHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t capacity;
+    std::uint32_t count;
+};
+static_assert(sizeof(SaveContainerHeader) == 16);
+
+// Many named saves in one file: a fixed-size header and slot index up front, payloads
+// appended behind it. Writing a slot appends its payload and then rewrites one index entry,
+// so a torn write never corrupts older slots. Listing reads only the index, and loading a
+// slot maps the file and deserializes from the slot's byte range. A durable write reaches the
+// disk before it reports success: the payload is synced before the index entry pointing at it
+// is written, and the index after. Rewriting a slot leaves its old payload behind as garbage
+// until compact() runs, which also happens when the index is full.
+struct SaveContainer {
+    static constexpr char MAGIC[4] = {'G', 'B', 'S', 'V'};
+    static constexpr std::uint32_t VERSION = 1;
+
+    std::filesystem::path path;
+    SaveContainerHeader header = {};
+    std::vector<SaveSlot> slots;
+    std::uint64_t garbage = 0;
+    bool opened = false;    // open() succeeded; until then every other call fails
+    std::mutex mutex;
+
+    explicit SaveContainer(const std::filesystem::path& path, std::uint32_t capacity = 256) :
+        path(path)
+    {
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.capacity = capacity;
+    }
+
+    static std::uint32_t checksum(std::span<const std::byte> bytes) {
+        static const auto table = [] {
+            std::array<std::uint32_t, 256> t;
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t c = i;
+                for (int k = 0; k < 8; ++k)
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (auto b : bytes)
+            crc = table[(crc ^ std::uint32_t(b)) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    std::uint64_t dataStart() const {
+        return sizeof(SaveContainerHeader) + std::uint64_t(header.capacity) * sizeof(SaveSlot);
+    }
+
+    // Reads the index of an existing container, or creates an empty one. A file at `path`
+    // that is not a container is left alone and the call fails.
+    bool open() {
+        std::lock_guard lock(mutex);
+        opened = false;
+        std::ifstream in(path, std::ios::binary);
+        SaveContainerHeader h;
+        if (in) {
+            if (!in.read((char*)&h, sizeof(h)) || std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) || h.version != VERSION || h.count > h.capacity)
+                return false;
+            header = h;
+            slots.resize(header.count);
+            if (header.count && !in.read((char*)slots.data(), std::streamsize(header.count * sizeof(SaveSlot))))
+                return false;
+            std::error_code ec;
+            std::uint64_t live = 0;
+            for (auto& s : slots)
+                live += s.size;
+            auto total = std::filesystem::file_size(path, ec);
+            garbage = ec || total < dataStart() + live ? 0 : total - dataStart() - live;
+            return opened = true;
+        }
+        header.count = 0;
+        slots.clear();
+        garbage = 0;
+        return opened = writeIndex(path, header, slots, {});
+    }
+
+    std::vector<SaveSlot> list() {
+        std::lock_guard lock(mutex);
+        return opened ? slots : std::vector<SaveSlot>();
+    }
+
+    bool find(const std::string& name, SaveSlot& slot) {
+        std::lock_guard lock(mutex);
+        if (!opened)
+            return false;
+        auto it = findSlot(name);
+        if (it == slots.end())
+            return false;
+        slot = *it;
+        return true;
+    }
+
+    bool write(const std::string& name, std::uint64_t frame, std::span<const std::byte> bytes, bool durable = false) {
+        std::lock_guard lock(mutex);
+        if (!opened || name.size() >= sizeof(SaveSlot::name))
+            return false;
+        auto it = findSlot(name);
+        if (it == slots.end() && slots.size() == header.capacity) {
+            if (!compactLocked(header.capacity * 2, durable))
+                return false;
+            it = slots.end();
+        }
+
+        std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!f.seekp(0, std::ios::end))
+            return false;
+        SaveSlot slot = {};
+        std::memcpy(slot.name, name.data(), name.size());
+        slot.offset = std::uint64_t(f.tellp());
+        slot.size = bytes.size();
+        slot.frame = frame;
+        slot.timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        slot.checksum = checksum(bytes);
+        if (!f.write((const char*)bytes.data(), std::streamsize(bytes.size())) || !f.flush())
+            return false;
+        if (durable && !syncFile(path))
+            return false;
+
+        std::size_t index;
+        if (it == slots.end()) {
+            index = slots.size();
+            slots.push_back(slot);
+        } else {
+            index = std::size_t(it - slots.begin());
+            garbage += it->size;
+            *it = slot;
+        }
+        header.count = std::uint32_t(slots.size());
+        f.seekp(std::streamoff(sizeof(SaveContainerHeader) + index * sizeof(SaveSlot)));
+        f.write((const char*)&slot, sizeof(slot));
+        f.seekp(0);
+        f.write((const char*)&header, sizeof(header));
+        f.flush();
+        if (!f || (durable && !syncFile(path)))
+            return false;
+
+        if (garbage > 64u * 1024 * 1024 && garbage > liveBytes())
+            compactLocked(header.capacity, durable);
+        return true;
+    }
+
+    // Maps the container and returns the payload of `name` in `payload`, checksum verified.
+    // `file` has to outlive every use of `payload`.
+    bool read(const std::string& name, MappedFile& file, std::span<const std::byte>& payload) {
+        SaveSlot slot;
+        if (!find(name, slot) || !file.openRead(path) || slot.offset + slot.size > file.size)
+            return false;
+        file.prefetch(std::size_t(slot.offset), std::size_t(slot.size));
+        payload = std::as_const(file).bytes().subspan(std::size_t(slot.offset), std::size_t(slot.size));
+        return checksum(payload) == slot.checksum;
+    }
+
+    // Rewrites the container with only the live payloads and an index of `capacity` slots.
+    bool compact(std::uint32_t capacity = 0) {
+        std::lock_guard lock(mutex);
+        return opened && compactLocked(capacity ? capacity : header.capacity);
+    }
+
+private:
+    std::vector<SaveSlot>::iterator findSlot(const std::string& name) {
+        return std::find_if(slots.begin(), slots.end(), [&](const SaveSlot& s) {
+            return name.size() < sizeof(s.name) && !std::strncmp(s.name, name.c_str(), sizeof(s.name));
+        });
+    }
+
+    std::uint64_t liveBytes() const {
+        std::uint64_t live = 0;
+        for (auto& s : slots)
+            live += s.size;
+        return live;
+    }
+
+    static bool writeIndex(const std::filesystem::path& to, const SaveContainerHeader& h, const std::vector<SaveSlot>& used, std::span<const std::byte> payloads, bool durable = false) {
+        std::ofstream out(to, std::ios::binary | std::ios::trunc);
+        std::vector<SaveSlot> index(h.capacity, SaveSlot{});
+        std::copy(used.begin(), used.end(), index.begin());
+        out.write((const char*)&h, sizeof(h));
+        out.write((const char*)index.data(), std::streamsize(index.size() * sizeof(SaveSlot)));
+        out.write((const char*)payloads.data(), std::streamsize(payloads.size()));
+        out.close();
+        return out && (!durable || syncFile(to));
+    }
+
+    bool compactLocked(std::uint32_t capacity, bool durable = false) {
+        MappedFile file;
+        if (!file.openRead(path))
+            return false;
+        auto newHeader = header;
+        newHeader.capacity = std::max<std::uint32_t>(capacity, std::uint32_t(slots.size()));
+        auto newSlots = slots;
+        std::uint64_t start = sizeof(SaveContainerHeader) + std::uint64_t(newHeader.capacity) * sizeof(SaveSlot);
+        std::vector<std::byte> payloads;
+        payloads.reserve(std::size_t(liveBytes()));
+        for (auto& s : newSlots) {
+            if (s.offset + s.size > file.size)
+                return false;
+            auto src = std::as_const(file).bytes().subspan(std::size_t(s.offset), std::size_t(s.size));
+            s.offset = start + payloads.size();
+            payloads.insert(payloads.end(), src.begin(), src.end());
+        }
+        file.close();
+        auto tmp = path;
+        tmp += ".tmp";
+        std::error_code ec;
+        if (!writeIndex(tmp, newHeader, newSlots, payloads, durable))
+            return false;
+        std::filesystem::rename(tmp, path, ec);
+        if (ec)
+            return false;
+        header = newHeader;
+        slots = std::move(newSlots);
+        garbage = 0;
+        return true;
+    }
+};
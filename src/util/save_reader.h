@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zpp_bits.h"
+#include "mapped_file.h"
+#include "save_codec.h"
+#include "save_container.h"
+
+// Uncompressed saves are deserialized straight out of the mapped container; compressed
+// ones are decompressed chunk by chunk into `buffer` first. Saves written as loose files
+// before the container existed are still found by name.
+inline bool readSave(SaveContainer& saves, const std::string& name, std::vector<std::byte>& buffer, auto&... args) {
+    MappedFile file;
+    std::span<const std::byte> payload;
+    if (!saves.read(name, file, payload)) {
+        if (!file.openRead(name)) {
+            std::cerr << "Failed to open save " << name << std::endl;
+            return false;
+        }
+        file.prefetch();
+        payload = std::as_const(file).bytes();
+    }
+    if (SaveCompression::isCompressed(payload)) {
+        if (!SaveCompression::decompress(payload, buffer)) {
+            std::cerr << "Failed to decompress save " << name << std::endl;
+            return false;
+        }
+        payload = buffer;
+    }
+    zpp::bits::in in(payload);
+    if (zpp::bits::failure(in(args...))) {
+        std::cerr << "Failed to read save " << name << std::endl;
+        return false;
+    }
+    return true;
+}
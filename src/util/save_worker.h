@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zpp_bits.h"
+#include "mapped_file.h"
+#include "save_codec.h"
+
+// Writes saves on a background thread. The caller only serializes (into one of two reusable
+// buffers); the worker compresses and does the file I/O from the other. A save requested while the worker
+// is busy replaces any save that is still waiting, so at most one write is in flight and one
+// queued no matter how often save() is called. By default the bytes go to a file named by
+// the save target; `write` can route them elsewhere. Callbacks run on the worker thread.
+struct SaveWorker {
+    std::function<bool(const std::string&, std::uint64_t, std::span<const std::byte>)> write;
+    std::function<void(const std::string&, std::size_t)> onComplete;
+    std::function<void(const std::string&, const std::string&)> onError;
+    bool durable = false;   // flush saves to disk before reporting them; a custom `write` has to honour it
+
+    std::vector<std::byte> buffers[2];
+    std::string targets[2];
+    std::uint64_t frames[2] = {};
+    SaveCodecId codecs[2] = {};
+    std::vector<std::byte> compressed;
+    int pending = -1, active = -1;
+    bool running = false;
+    std::mutex mutex;
+    std::condition_variable cv, idle;
+    std::thread thread;
+
+    SaveWorker() = default;
+    SaveWorker(const SaveWorker&) = delete;
+    SaveWorker& operator=(const SaveWorker&) = delete;
+
+    ~SaveWorker() {
+        stop();
+    }
+
+    void start() {
+        std::lock_guard lock(mutex);
+        if (running)
+            return;
+        running = true;
+        thread = std::thread([this] { run(); });
+    }
+
+    // Finishes the queued save, if any, and joins the worker.
+    void stop() {
+        {
+            std::lock_guard lock(mutex);
+            running = false;
+        }
+        cv.notify_one();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    // Serializes `args` on the calling thread and queues the bytes for compressing with
+    // `codec` and writing to `target`.
+    bool save(const std::string& target, std::uint64_t frame, SaveCodecId codec, auto&... args) {
+        int slot;
+        {
+            // Take back a save that has not started yet; its buffer is about to be overwritten.
+            std::lock_guard lock(mutex);
+            pending = -1;
+            slot = active == 0 ? 1 : 0;
+        }
+        auto& buffer = buffers[slot];
+        zpp::bits::out out(buffer);
+        if (zpp::bits::failure(out(args...))) {
+            if (onError)
+                onError(target, "serialization failed");
+            return false;
+        }
+        buffer.resize(out.position());
+        {
+            std::lock_guard lock(mutex);
+            targets[slot] = target;
+            frames[slot] = frame;
+            codecs[slot] = codec;
+            pending = slot;
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    // Blocks until every requested save has been written.
+    void wait() {
+        std::unique_lock lock(mutex);
+        idle.wait(lock, [this] { return pending < 0 && active < 0; });
+    }
+
+private:
+    void run() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return !running || pending >= 0; });
+            if (pending < 0)
+                break;
+            active = pending;
+            pending = -1;
+            auto target = targets[active];
+            auto frame = frames[active];
+            auto codec = codecs[active];
+            std::span<const std::byte> bytes = buffers[active];
+            lock.unlock();
+
+            if (codec != SAVE_CODEC_NONE) {
+                SaveCompression::compress(codec, bytes, compressed);
+                bytes = compressed;
+            }
+            bool ok = write ? write(target, frame, bytes) : writeMappedBytes(target, bytes, durable);
+            if (ok && onComplete)
+                onComplete(target, bytes.size());
+            else if (!ok && onError)
+                onError(target, "write failed");
+
+            lock.lock();
+            active = -1;
+            idle.notify_all();
+        }
+        idle.notify_all();
+    }
+};
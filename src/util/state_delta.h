@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Byte-level delta between two serialized states. The target is XORed against the base
+// (bytes past the end of the base count as zero) and stored as alternating varint-coded
+// runs: <skip zero bytes> <n literal bytes> <n xor bytes> ..., prefixed by the target size.
+// Consecutive frames of a game usually differ in a handful of fields, so a delta is a
+// tiny fraction of the full state.
+struct StateDelta {
+    static void putVarint(std::vector<std::byte>& out, std::uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back(std::byte(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(std::byte(v));
+    }
+
+    static bool getVarint(std::span<const std::byte> in, std::size_t& pos, std::uint64_t& v) {
+        v = 0;
+        for (int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+            auto b = std::uint64_t(in[pos++]);
+            v |= (b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    static std::byte at(std::span<const std::byte> s, std::size_t i) {
+        return i < s.size() ? s[i] : std::byte(0);
+    }
+
+    // Length of the run of equal bytes starting at i, compared eight bytes at a time.
+    static std::size_t sameRun(std::span<const std::byte> base, std::span<const std::byte> target, std::size_t i) {
+        std::size_t start = i, common = std::min(base.size(), target.size());
+        for (; i + 8 <= common; i += 8) {
+            std::uint64_t a, b;
+            std::memcpy(&a, base.data() + i, 8);
+            std::memcpy(&b, target.data() + i, 8);
+            if (a != b)
+                break;
+        }
+        while (i < target.size() && at(base, i) == target[i])
+            ++i;
+        return i - start;
+    }
+
+    static void encode(std::span<const std::byte> base, std::span<const std::byte> target, std::vector<std::byte>& out) {
+        out.clear();
+        putVarint(out, target.size());
+        std::size_t i = 0;
+        while (i < target.size()) {
+            std::size_t skip = sameRun(base, target, i);
+            i += skip;
+            std::size_t literal = i;
+            // A short equal run inside a changed region is cheaper to keep as literal bytes.
+            while (literal < target.size() && (at(base, literal) != target[literal] || (literal + 1 < target.size() && at(base, literal + 1) != target[literal + 1])))
+                ++literal;
+            putVarint(out, skip);
+            putVarint(out, literal - i);
+            for (; i < literal; ++i)
+                out.push_back(target[i] ^ at(base, i));
+        }
+    }
+
+    static bool decode(std::span<const std::byte> base, std::span<const std::byte> delta, std::vector<std::byte>& out) {
+        std::size_t pos = 0;
+        std::uint64_t size;
+        if (!getVarint(delta, pos, size))
+            return false;
+        out.resize(size);
+        // std::copy_n/fill, unlike memcpy/memset, are fine with the null data() of empty spans.
+        auto kept = std::min<std::size_t>(size, base.size());
+        std::copy_n(base.begin(), kept, out.begin());
+        std::fill(out.begin() + kept, out.end(), std::byte(0));
+        std::size_t i = 0;
+        while (pos < delta.size()) {
+            std::uint64_t skip, literal;
+            if (!getVarint(delta, pos, skip) || !getVarint(delta, pos, literal))
+                return false;
+            i += skip;
+            if (i + literal > size || pos + literal > delta.size())
+                return false;
+            for (std::size_t end = i + literal; i < end; ++i)
+                out[i] ^= delta[pos++];
+        }
+        return true;
+    }
+};
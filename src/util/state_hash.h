@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Non-cryptographic 64-bit hash for serialized states, cheap enough to run every frame. The
+// input is consumed in 32-byte stripes by eight independent 32-bit lanes (an xxHash32 round
+// per lane), which compilers turn into SIMD multiplies and rotates; the lanes, the tail and
+// the length are folded into 64 bits at the end. Results are only meant to be compared on
+// machines of the same endianness.
+struct StateHash {
+    static constexpr int LANES = 8;
+    static constexpr std::size_t STRIPE = LANES * sizeof(std::uint32_t);
+
+    static std::uint64_t hash(std::span<const std::byte> bytes, std::uint64_t seed = 0) {
+        const std::byte* p = bytes.data();
+        std::size_t n = bytes.size();
+        std::uint32_t acc[LANES];
+        for (int i = 0; i < LANES; ++i)
+            acc[i] = std::uint32_t(seed) + P1 * std::uint32_t(i + 1);
+        for (std::size_t stripes = n / STRIPE; stripes; --stripes, p += STRIPE) {
+            std::uint32_t v[LANES];
+            std::memcpy(v, p, STRIPE);
+            for (int i = 0; i < LANES; ++i) {
+                std::uint32_t a = acc[i] + v[i] * P2;
+                acc[i] = ((a << 13) | (a >> 19)) * P1;
+            }
+        }
+
+        std::uint64_t h = seed ^ (std::uint64_t(n) * P64);
+        for (int i = 0; i < LANES; i += 2)
+            h = mix(h ^ (std::uint64_t(acc[i]) | std::uint64_t(acc[i + 1]) << 32));
+        std::size_t tail = n % STRIPE;
+        for (; tail >= 8; tail -= 8, p += 8) {
+            std::uint64_t v;
+            std::memcpy(&v, p, 8);
+            h = mix(h ^ v);
+        }
+        if (tail) {
+            std::uint64_t v = 0;
+            std::memcpy(&v, p, tail);
+            h = mix(h ^ v ^ (std::uint64_t(tail) << 59));
+        }
+        return mix(h);
+    }
+
+private:
+    static constexpr std::uint32_t P1 = 0x9E3779B1u;
+    static constexpr std::uint32_t P2 = 0x85EBCA77u;
+    static constexpr std::uint64_t P64 = 0x9E3779B97F4A7C15ull;
+
+    static std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return x;
+    }
+};
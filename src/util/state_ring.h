@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "zpp_bits.h"
+#include "state_delta.h"
+
+// Fixed-capacity history of the last N serialized states. Every `keyframeInterval` frames a
+// full state is stored; the frames in between keep only a StateDelta against the previous
+// frame. Entry buffers are reused as the ring wraps, so once they have grown to their
+// working size capturing a frame does not allocate.
+template <typename T>
+struct StateRing {
+    struct Entry {
+        std::vector<std::byte> bytes;
+        bool keyframe = false;
+    };
+
+    std::size_t capacity, keyframeInterval;
+    std::vector<Entry> entries;
+    std::vector<std::byte> prev, current, scratch;
+    std::size_t head = 0, count = 0, sinceKeyframe = 0;
+
+    StateRing(std::size_t capacity, std::size_t keyframeInterval = 1) :
+        capacity(capacity),
+        keyframeInterval(std::max<std::size_t>(keyframeInterval, 1)),
+        entries(capacity)
+    { }
+
+    // Returns false if `state` could not be serialized, which stores nothing.
+    bool capture(const T& state) {
+        zpp::bits::out out(current);
+        if (zpp::bits::failure(out(state)))
+            return false;
+        current.resize(out.position());
+
+        auto& entry = entries[head];
+        entry.keyframe = count == 0 || sinceKeyframe + 1 >= keyframeInterval;
+        if (entry.keyframe) {
+            entry.bytes.assign(current.begin(), current.end());
+            sinceKeyframe = 0;
+        } else {
+            StateDelta::encode(prev, current, entry.bytes);
+            ++sinceKeyframe;
+        }
+        std::swap(prev, current);
+        head = (head + 1) % capacity;
+        count = std::min(count + 1, capacity);
+        return true;
+    }
+
+    // Serialized bytes of the newest state, captured or restored; valid until the next call.
+    std::span<const std::byte> newest() const {
+        return prev;
+    }
+
+    // Restores the state captured `steps` frames before the newest one and forgets every
+    // newer state, so capturing continues from the restored point. Fails if the state is
+    // no longer reachable from a keyframe still held in the ring.
+    bool rewind(std::size_t steps, T& into) {
+        if (steps >= count)
+            return false;
+        std::size_t back = steps, oldest = count - 1;
+        while (!entries[index(back)].keyframe) {
+            if (back == oldest)
+                return false;
+            ++back;
+        }
+        scratch.assign(entries[index(back)].bytes.begin(), entries[index(back)].bytes.end());
+        for (std::size_t b = back; b > steps; --b) {
+            if (!StateDelta::decode(scratch, entries[index(b - 1)].bytes, current))
+                return false;
+            std::swap(scratch, current);
+        }
+        zpp::bits::in in(scratch);
+        if (zpp::bits::failure(in(into)))
+            return false;
+
+        std::swap(prev, scratch);
+        sinceKeyframe = back - steps;
+        head = (head + capacity - steps) % capacity;
+        count -= steps;
+        return true;
+    }
+
+    void clear() {
+        head = count = sinceKeyframe = 0;
+    }
+
+    // Bytes held by the history, for sizing the capacity.
+    std::size_t memoryUsage() const {
+        std::size_t total = 0;
+        for (auto& e : entries)
+            total += e.bytes.capacity();
+        return total;
+    }
+
+private:
+    // Ring position of the entry `back` frames before the newest one.
+    std::size_t index(std::size_t back) const {
+        return (head + capacity - 1 - back) % capacity;
+    }
+};